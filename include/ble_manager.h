@@ -13,13 +13,15 @@ class BLEManager
 {
 public:
     BLEManager();
-    void init();
-    void loop();
+    void init(); // 重複呼叫不會重新初始化
+    void loop(); // 尚未 init() 時不做任何事
+    bool isInitialized();
 
 private:
     BLEServer *pServer;
     BLECharacteristic *pRxCharacteristic;
     BLECharacteristic *pTxCharacteristic;
+    bool initialized;
     void setupServices();
     void handleRxData(const std::string &data);
 };
@@ -0,0 +1,59 @@
+#ifndef BOARD_CONFIG_H
+#define BOARD_CONFIG_H
+
+#include <stdint.h>
+
+/**
+ * @file board_config.h
+ * @brief 編譯期設定 - 板子腳位與模組開關
+ *
+ * 由 platformio.ini 各 env 的 build_flags 選擇:
+ * - PULMOTE_BOARD_CUSTOM：使用 PULMOTE_IR_RX_PIN / PULMOTE_IR_TX_PIN / PULMOTE_STATUS_PIN
+ * - 未指定時使用 ESP32 DevKit V3 腳位
+ * - PULMOTE_ENABLE_BLE / PULMOTE_ENABLE_MQTT / PULMOTE_ENABLE_IR：0 表示該模組與其函式庫完全不編譯
+ * - PULMOTE_ENABLE_OTA：差異更新，分區表須包含 ota_0 / ota_1（預設關閉）
+ *
+ * 腳位皆為 constexpr，呼叫端直接展開為常數。
+ */
+
+#ifndef PULMOTE_ENABLE_BLE
+#define PULMOTE_ENABLE_BLE 1
+#endif
+
+#ifndef PULMOTE_ENABLE_MQTT
+#define PULMOTE_ENABLE_MQTT 1
+#endif
+
+#ifndef PULMOTE_ENABLE_IR
+#define PULMOTE_ENABLE_IR 1
+#endif
+
+#ifndef PULMOTE_ENABLE_OTA
+#define PULMOTE_ENABLE_OTA 0
+#endif
+
+namespace board
+{
+    struct DevKitV3 // ESP32 DevKit V3.0 (ESP32-WROOM-32)，對應 README 接線圖
+    {
+        static const char *name() { return "esp32-devkit-v3"; }
+        static constexpr uint16_t kIrRxPin = 15;
+        static constexpr uint16_t kIrTxPin = 4;
+        static constexpr uint16_t kStatusPin = 2;
+    };
+
+#if defined(PULMOTE_BOARD_CUSTOM)
+    struct Custom
+    {
+        static const char *name() { return "custom"; }
+        static constexpr uint16_t kIrRxPin = PULMOTE_IR_RX_PIN;
+        static constexpr uint16_t kIrTxPin = PULMOTE_IR_TX_PIN;
+        static constexpr uint16_t kStatusPin = PULMOTE_STATUS_PIN;
+    };
+    typedef Custom Active;
+#else
+    typedef DevKitV3 Active;
+#endif
+} // namespace board
+
+#endif // BOARD_CONFIG_H
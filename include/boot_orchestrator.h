@@ -0,0 +1,61 @@
+#ifndef BOOT_ORCHESTRATOR_H
+#define BOOT_ORCHESTRATOR_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#include "boot_schedule.h"
+
+/**
+ * @file boot_orchestrator.h
+ * @brief 開機流程管理 - 依相依順序同時啟動各模組並記錄時間軸
+ *
+ * 功能:
+ * - 相依皆已完成的模組各自在 FreeRTOS task 中同時執行 init()
+ * - lazy 模組（例如 BLE）在第一次使用時才啟動
+ * - background 模組（例如等待 WiFi 連線）不延遲 run() 返回，由 loop() 呼叫 poll() 收尾
+ * - 開機完成後印出每個模組的開始 / 結束時間與 time-to-ready
+ */
+
+#ifndef BOOT_TASK_STACK
+#define BOOT_TASK_STACK 8192
+#endif
+
+class BootOrchestrator
+{
+public:
+    BootOrchestrator();
+    bool add(const char *name, boot_fn_t fn, const char *deps, bool lazy = false, bool background = false);
+    bool run();                         // 啟動所有非 lazy 模組，非 background 模組完成後返回
+    void poll();                        // 於 loop() 呼叫：記錄 background 模組完成並啟動相依它們的模組
+    bool ensure(const char *name);      // 啟動 lazy 模組（已啟動則直接返回）
+    bool isDone(const char *name) const; // init() 已完成
+    void printTimeline();
+
+private:
+    struct TaskArg
+    {
+        BootOrchestrator *self;
+        int index;
+    };
+    struct DoneEvent
+    {
+        int index;
+        uint32_t start_us;
+        uint32_t end_us;
+    };
+
+    BootSchedule schedule;
+    TaskArg args[BOOT_MAX_TASKS];
+    QueueHandle_t doneQueue;
+    uint32_t bootStartUs; // run() 開始時間
+    uint32_t readyUs;     // 非 lazy、非 background 模組完成的時間（run() 返回）
+    uint32_t finishedUs;  // 包含 background 在內所有非 lazy 模組完成的時間
+    void startReady();
+    void finish();
+    void printTask(size_t index);
+    static void taskEntry(void *arg);
+};
+
+#endif // BOOT_ORCHESTRATOR_H
@@ -0,0 +1,73 @@
+#ifndef BOOT_SCHEDULE_H
+#define BOOT_SCHEDULE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file boot_schedule.h
+ * @brief 開機排程 - 模組啟動的相依順序與時間軸
+ *
+ * 功能:
+ * - 以名稱宣告相依（例如 "wifi,ir"），resolve() 檢查未知名稱與循環相依
+ * - nextReady() 回傳相依皆已完成的模組，可同時啟動多個
+ * - lazy 模組不在開機時啟動，第一次使用時才由 startLazy() 啟動
+ * - background 模組（例如等待 WiFi 連線）與相依它的模組在開機返回後繼續執行，
+ *   foregroundFinished() 只等其餘模組
+ * - 記錄每個模組的開始 / 結束時間
+ *
+ * 本模組不依賴 Arduino / FreeRTOS，可在主機端編譯；實際執行見 boot_orchestrator.h。
+ */
+
+#ifndef BOOT_MAX_TASKS
+#define BOOT_MAX_TASKS 8
+#endif
+
+typedef void (*boot_fn_t)();
+
+struct BootTaskInfo
+{
+    enum State : uint8_t
+    {
+        PENDING,
+        RUNNING,
+        DONE
+    };
+
+    const char *name;
+    boot_fn_t fn;
+    const char *dep_names; // 以逗號分隔的相依模組名稱
+    uint32_t deps;         // resolve() 後的相依位元遮罩
+    bool lazy;
+    bool background; // resolve() 後包含相依 background 模組的模組
+    State state;
+    uint32_t start_us;
+    uint32_t end_us;
+};
+
+class BootSchedule
+{
+public:
+    BootSchedule();
+    int add(const char *name, boot_fn_t fn, const char *deps, bool lazy, bool background = false); // 回傳索引，失敗為 -1
+    bool resolve();                                  // 未知相依、循環相依或非 lazy 模組相依 lazy 模組時回傳 false
+    int nextReady(uint32_t now_us);                  // 取出可啟動的模組並標記為執行中，沒有則回傳 -1
+    bool startLazy(int index, uint32_t now_us);      // 相依尚未完成或已啟動時回傳 false
+    void markDone(int index, uint32_t start_us, uint32_t end_us);
+    bool finished() const;                           // 所有非 lazy 模組皆已完成
+    bool foregroundFinished() const;                 // 所有非 lazy、非 background 模組皆已完成
+    size_t running() const;
+    int find(const char *name) const;
+    size_t count() const;
+    const BootTaskInfo &task(size_t index) const;
+
+private:
+    BootTaskInfo tasks[BOOT_MAX_TASKS];
+    size_t task_count;
+    uint32_t done_mask;
+    bool resolved;
+    bool background_declared[BOOT_MAX_TASKS]; // add() 時指定的值，resolve() 由此重新推導
+    int findName(const char *name, size_t length) const;
+};
+
+#endif // BOOT_SCHEDULE_H
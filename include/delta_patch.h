@@ -0,0 +1,102 @@
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file delta_patch.h
+ * @brief 韌體差異更新 - 串流套用 delta patch
+ *
+ * Patch 格式（由 scripts/delta_ota.py 產生，整數皆為 little-endian）:
+ * - 標頭 80 bytes: "PDLT" | version(u8) | flags(u8) | reserved(u16) | old_size(u32) | new_size(u32)
+ *                  | old_sha256[32] | new_sha256[32]
+ * - flags & DELTA_FLAG_SIGNED 時接著 64 bytes 簽章: ECDSA P-256 對標頭 SHA-256 的 r[32] | s[32]（big-endian）
+ *   標頭含新映像的 SHA-256，簽章因此涵蓋整個新映像
+ * - 指令流（flags & DELTA_FLAG_DEFLATE 時為 raw deflate 壓縮）:
+ *   - 0x00 END
+ *   - 0x01 COPY  zigzag(offset 差值) len          新資料 = 舊映像
+ *   - 0x02 ADD   len bytes[len]                    新資料 = bytes
+ *   - 0x03 DIFF  zigzag(offset 差值) len bytes[len] 新資料 = 舊映像 + bytes（逐位元組相加）
+ *   offset 差值相對於上一個 COPY / DIFF 結束的位置，數值皆為 LEB128 varint。
+ *
+ * DeltaPatchApplier 接收解壓後的指令流，可以任意大小的片段輸入；
+ * 讀取舊映像與輸出新映像都透過回呼，RAM 只需 DELTA_PATCH_WINDOW bytes。
+ *
+ * 本模組不依賴 Arduino，可在主機端編譯。
+ */
+
+#define DELTA_PATCH_HEADER_SIZE 80
+#define DELTA_PATCH_VERSION 1
+#define DELTA_PATCH_SIGNATURE_SIZE 64
+#define DELTA_FLAG_DEFLATE 0x01
+#define DELTA_FLAG_SIGNED 0x02
+
+#ifndef DELTA_PATCH_WINDOW
+#define DELTA_PATCH_WINDOW 1024
+#endif
+
+struct DeltaPatchHeader
+{
+    uint8_t flags;
+    uint32_t old_size;
+    uint32_t new_size;
+    uint8_t old_sha256[32];
+    uint8_t new_sha256[32];
+};
+
+bool deltaPatchParseHeader(const uint8_t *data, DeltaPatchHeader &header); // magic 或版本不符時回傳 false
+size_t deltaPatchDataOffset(const DeltaPatchHeader &header);              // 指令流的起始位置（標頭與簽章之後）
+
+typedef bool (*delta_read_old_t)(uint32_t offset, uint8_t *buf, size_t len, void *context);
+typedef bool (*delta_write_new_t)(const uint8_t *buf, size_t len, void *context);
+
+enum DeltaPatchStatus
+{
+    DELTA_NEED_MORE = 0, // 尚未結束，繼續輸入
+    DELTA_DONE,          // END 且輸出長度正確
+    DELTA_BAD_OP,        // 未知指令或 varint 過長
+    DELTA_OUT_OF_RANGE,  // 超出舊映像或新映像範圍
+    DELTA_IO_ERROR,      // 回呼失敗
+    DELTA_TRAILING_DATA  // END 之後還有資料
+};
+
+class DeltaPatchApplier
+{
+public:
+    DeltaPatchApplier();
+    void begin(uint32_t old_size, uint32_t new_size, delta_read_old_t read_old, delta_write_new_t write_new, void *context);
+    DeltaPatchStatus feed(const uint8_t *data, size_t len);
+    DeltaPatchStatus status() const;
+    uint32_t written() const;
+
+private:
+    enum Phase : uint8_t
+    {
+        PHASE_OP,
+        PHASE_OFFSET,
+        PHASE_LENGTH,
+        PHASE_DATA
+    };
+
+    uint8_t window[DELTA_PATCH_WINDOW];
+    delta_read_old_t read_old;
+    delta_write_new_t write_new;
+    void *context;
+    uint32_t old_size;
+    uint32_t new_size;
+    uint32_t out_pos;
+    uint32_t old_pos;   // 下一個 COPY / DIFF 的基準位置
+    uint32_t remaining; // 目前指令尚未處理的位元組
+    uint32_t varint;
+    uint8_t varint_shift;
+    uint8_t op;
+    Phase phase;
+    DeltaPatchStatus last_status;
+
+    bool readVarint(uint8_t byte, bool &complete);
+    DeltaPatchStatus startData();
+    DeltaPatchStatus copyOld();
+};
+
+#endif // DELTA_PATCH_H
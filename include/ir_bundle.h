@@ -0,0 +1,128 @@
+#ifndef IR_BUNDLE_H
+#define IR_BUNDLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file ir_bundle.h
+ * @brief 紅外線指令庫備份格式 - 串流編碼 / 解碼
+ *
+ * 格式（所有整數皆為 little-endian）:
+ * - 標頭 16 bytes: "PIRB" | version(u8) | flags(u8) | reserved(u16) | record_count(u32) | crc32(前 12 bytes)
+ * - 每筆紀錄: name_len(u8) | reserved(u8) | sample_count(u16) | name | samples(u16 * n) | crc32(本筆前述內容)
+ * - 結尾 12 bytes: "PIRE" | record_count(u32) | crc32(所有紀錄內容)
+ *
+ * 編碼與解碼都只保留一筆紀錄的緩衝區，可以任意大小的片段（HTTP chunk、MQTT 訊息）
+ * 輸出或輸入。解碼器可匯出檢查點，中斷後從紀錄邊界繼續。
+ *
+ * 本模組不依賴 Arduino，可在主機端編譯。
+ */
+
+#define IR_BUNDLE_VERSION 1
+#define IR_BUNDLE_HEADER_SIZE 16
+#define IR_BUNDLE_TRAILER_SIZE 12
+#define IR_BUNDLE_RECORD_OVERHEAD 8 // 紀錄標頭 4 bytes + crc32 4 bytes
+
+#ifndef IR_BUNDLE_MAX_NAME
+#define IR_BUNDLE_MAX_NAME 32
+#endif
+
+#ifndef IR_BUNDLE_MAX_SAMPLES
+#define IR_BUNDLE_MAX_SAMPLES 1024
+#endif
+
+#define IR_BUNDLE_MAX_FRAME (IR_BUNDLE_RECORD_OVERHEAD + IR_BUNDLE_MAX_NAME + IR_BUNDLE_MAX_SAMPLES * 2)
+
+uint32_t irBundleCrc32(uint32_t crc, const uint8_t *data, size_t length);
+
+// 指令名稱限用英數字、'-'、'_'，同時作為檔名使用
+bool irBundleValidName(const char *name, size_t length);
+
+/**
+ * 解碼出的一筆紀錄，指標指向解碼器內部緩衝區，只在回呼期間有效。
+ * samples 保留 little-endian 原始位元組，可直接寫入儲存裝置。
+ */
+struct IRBundleRecord
+{
+    const char *name;
+    uint8_t name_len;
+    uint16_t sample_count;
+    const uint8_t *samples;
+};
+
+class IRBundleWriter
+{
+public:
+    IRBundleWriter();
+    void begin(uint32_t record_count);
+    // 準備一筆紀錄，回傳樣本區指標（sample_count * 2 bytes）供呼叫端直接填入；參數不合法時回傳 nullptr
+    uint8_t *beginRecord(const char *name, uint16_t sample_count);
+    void commitRecord();
+    void finish();                          // 輸出結尾
+    size_t read(uint8_t *buf, size_t len);  // 取出已編碼的位元組
+    bool drained() const;                   // 目前的 frame 已全部讀出
+    uint32_t recordsWritten() const;
+
+private:
+    uint8_t frame[IR_BUNDLE_MAX_FRAME];
+    size_t frame_len;
+    size_t frame_pos;
+    uint32_t records;
+    uint32_t body_crc;
+};
+
+enum IRBundleStatus
+{
+    IR_BUNDLE_NEED_MORE = 0, // 尚未結束，繼續輸入
+    IR_BUNDLE_DONE,          // 結尾驗證通過
+    IR_BUNDLE_BAD_MAGIC,
+    IR_BUNDLE_BAD_VERSION,
+    IR_BUNDLE_BAD_CRC,
+    IR_BUNDLE_BAD_RECORD,   // 名稱或長度不合法
+    IR_BUNDLE_BAD_COUNT,    // 紀錄數量與標頭不符
+    IR_BUNDLE_REJECTED,     // 回呼拒絕（例如寫入失敗）
+    IR_BUNDLE_TRAILING_DATA // 結尾之後還有資料
+};
+
+// 可持久化的解碼進度，只在紀錄邊界記錄
+struct IRBundleCheckpoint
+{
+    uint32_t offset;       // 已處理完成的位元組數
+    uint32_t records;      // 已處理完成的紀錄數
+    uint32_t record_count; // 標頭宣告的紀錄數
+    uint32_t body_crc;
+};
+
+typedef bool (*ir_bundle_record_cb_t)(const IRBundleRecord &record, void *context);
+
+class IRBundleReader
+{
+public:
+    IRBundleReader();
+    void begin();                                  // 從頭開始解碼
+    bool resume(const IRBundleCheckpoint &state);  // 從檢查點繼續，下一個輸入位元組須位於 state.offset
+    IRBundleStatus feed(const uint8_t *data, size_t len, ir_bundle_record_cb_t callback, void *context);
+    IRBundleCheckpoint checkpoint() const;
+    IRBundleStatus status() const;
+
+private:
+    enum Phase : uint8_t
+    {
+        PHASE_HEADER,
+        PHASE_RECORD_HEAD,
+        PHASE_RECORD_BODY,
+        PHASE_TRAILER,
+        PHASE_END
+    };
+
+    uint8_t frame[IR_BUNDLE_MAX_FRAME];
+    size_t frame_len;
+    size_t frame_need;
+    Phase phase;
+    IRBundleStatus last_status;
+    IRBundleCheckpoint committed;
+    IRBundleStatus completeFrame(ir_bundle_record_cb_t callback, void *context);
+};
+
+#endif // IR_BUNDLE_H
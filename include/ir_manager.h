@@ -5,6 +5,11 @@
 #include <IRremoteESP8266.h>
 #include <IRrecv.h>
 #include <IRsend.h>
+#include <FS.h>
+#include <WebServer.h>
+#include <Preferences.h>
+
+#include "ir_bundle.h"
 
 /**
  * @file ir_manager.h
@@ -13,9 +18,19 @@
  * 功能:
  * - 接收紅外線訊號（學習模式）
  * - 發送紅外線訊號控制家電
- * - 儲存和播放學習到的遙控器指令
+ * - 儲存和播放學習到的遙控器指令（LittleFS /ir/<name>）
+ * - 以 ir_bundle 格式串流匯出 / 匯入整個指令庫，可中斷後續傳
  */
 
+// 匯入進度每前進這麼多筆紀錄或位元組才寫入 Preferences 一次，中斷後最多重做這段
+#ifndef IR_IMPORT_SAVE_RECORDS
+#define IR_IMPORT_SAVE_RECORDS 32
+#endif
+
+#ifndef IR_IMPORT_SAVE_BYTES
+#define IR_IMPORT_SAVE_BYTES 32768
+#endif
+
 class IRManager
 {
 public:
@@ -27,6 +42,14 @@ public:
     bool hasSignal();
     void getReceivedSignal();
     void loop();
+    bool saveCode(const char *name, const uint16_t *data, uint16_t length);
+    uint16_t loadCode(const char *name, uint16_t *data, uint16_t max_length); // 回傳樣本數，找不到為 0
+    bool beginExport();
+    size_t readExport(uint8_t *buf, size_t len); // 回傳 0 表示匯出結束
+    bool beginImport(uint32_t offset);           // offset 為 0 時重新開始，否則須與保存的進度相同
+    IRBundleStatus writeImport(const uint8_t *data, size_t len);
+    uint32_t importOffset();             // 保存於 Preferences 的進度，續傳由此開始
+    void registerRoutes(WebServer &server); // 註冊 /ir/export、/ir/import
     ~IRManager();
 
 private:
@@ -34,6 +57,18 @@ private:
     uint16_t ir_send_pin;
     uint16_t dev_status_pin;
     bool is_learning;
+    IRBundleWriter *exporter; // 匯出期間才配置，只保留一筆紀錄
+    File exportDir;
+    bool exportFinished;
+    bool exportFailed; // 讀檔失敗，匯出已中止
+    IRBundleReader *importer; // 匯入期間才配置
+    IRBundleStatus importStatus;
+    IRBundleCheckpoint importSaved; // 上次寫入 Preferences 的進度
+    Preferences preferences;    // 用於保存匯入進度
+    void endExport();
+    void endImport();
+    void saveImportProgress(bool force); // force 為 false 時依 IR_IMPORT_SAVE_* 間隔寫入
+    static bool importRecord(const IRBundleRecord &record, void *context);
 };
 
 #endif // IR_MANAGER_H
@@ -0,0 +1,79 @@
+#ifndef MODULE_REGISTRY_H
+#define MODULE_REGISTRY_H
+
+#include <stddef.h>
+
+/**
+ * @file module_registry.h
+ * @brief 靜態模組註冊 - 以模板在編譯期展開各模組的 init / loop
+ *
+ * 每個模組提供 name()、deps()、init()、loop() 四個 static 函式與 enabled / lazy / background 常數。
+ * deps() 為以逗號分隔的相依模組名稱，供 BootOrchestrator 排程使用。
+ * background 模組（與相依它的模組）不延遲開機，init() 完成前不會呼叫其 loop()。
+ * 停用的模組繼承 DisabledModule，呼叫會被編譯器整個移除。
+ */
+
+struct DisabledModule
+{
+    static const bool enabled = false;
+    static const bool lazy = false;
+    static const bool background = false;
+    static const char *name() { return ""; }
+    static const char *deps() { return ""; }
+    static void init() {}
+    static void loop() {}
+};
+
+template <typename... Modules>
+struct ModuleList;
+
+template <>
+struct ModuleList<>
+{
+    static const size_t enabledCount = 0;
+    static void initAll() {}
+    static void loopAll() {}
+    template <typename Sink>
+    static void loopAll(const Sink &) {}
+    template <typename Sink>
+    static void registerAll(Sink &) {}
+};
+
+// 依註冊順序展開（C++11，不使用 fold expression）
+template <typename First, typename... Rest>
+struct ModuleList<First, Rest...>
+{
+    static const size_t enabledCount = (First::enabled ? 1 : 0) + ModuleList<Rest...>::enabledCount;
+
+    static void initAll()
+    {
+        First::init();
+        ModuleList<Rest...>::initAll();
+    }
+
+    static void loopAll()
+    {
+        First::loop();
+        ModuleList<Rest...>::loopAll();
+    }
+
+    // 只呼叫 init() 已完成的模組，Sink 需提供 isDone(name)
+    template <typename Sink>
+    static void loopAll(const Sink &sink)
+    {
+        if (First::enabled && sink.isDone(First::name()))
+            First::loop();
+        ModuleList<Rest...>::loopAll(sink);
+    }
+
+    // 將已啟用的模組加入開機排程，Sink 需提供 add(name, fn, deps, lazy, background)
+    template <typename Sink>
+    static void registerAll(Sink &sink)
+    {
+        if (First::enabled)
+            sink.add(First::name(), First::init, First::deps(), First::lazy, First::background);
+        ModuleList<Rest...>::registerAll(sink);
+    }
+};
+
+#endif // MODULE_REGISTRY_H
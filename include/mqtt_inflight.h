@@ -0,0 +1,110 @@
+#ifndef MQTT_INFLIGHT_H
+#define MQTT_INFLIGHT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/**
+ * @file mqtt_inflight.h
+ * @brief MQTT QoS 1 發送視窗 - 追蹤尚未收到 PUBACK 的訊息
+ *
+ * 功能:
+ * - 分配 Packet ID 並以管線方式（pipelined）同時送出多筆訊息
+ * - 依 Packet ID 比對 PUBACK，釋放已確認的訊息
+ * - 重新連線後以 DUP 旗標重送未確認的訊息
+ * - 固定容量的重送暫存區，滿了就拒絕新訊息
+ *
+ * 本模組不依賴 Arduino，可在主機端編譯。
+ */
+
+// 同時在途（已送出、未收到 PUBACK）的訊息上限，可於 build_flags 覆寫
+#ifndef MQTT_INFLIGHT_WINDOW
+#define MQTT_INFLIGHT_WINDOW 8
+#endif
+
+// 重送暫存區容量（包含在途與排隊中的訊息）
+#ifndef MQTT_RETRY_STORE_SIZE
+#define MQTT_RETRY_STORE_SIZE 32
+#endif
+
+struct MQTTOutboundMessage
+{
+    std::string topic;
+    std::string payload;
+    uint16_t packet_id; // 0 表示尚未分配
+    bool retain;
+    bool dup; // 重送時設定 DUP 旗標
+};
+
+class MQTTInflightWindow
+{
+public:
+    MQTTInflightWindow();
+    void setWindow(uint8_t window); // 設定在途上限（1 ~ MQTT_RETRY_STORE_SIZE）
+    uint8_t getWindow() const;
+    bool enqueue(const char *topic, const char *payload, bool retain); // 暫存區已滿時回傳 false
+    MQTTOutboundMessage *nextToSend(); // 取出下一筆需要傳送的訊息，沒有則回傳 nullptr
+    bool acknowledge(uint16_t packet_id); // 收到 PUBACK
+    void requeueInflight();               // 重新連線後，將在途訊息標記為需重送
+    void setNextPacketId(uint16_t id);    // 指定下一個分配的 Packet ID（0 視為 1），測試用來模擬迴繞
+    size_t pending() const;               // 暫存區中的訊息數量
+    size_t inflight() const;              // 已送出、未確認的訊息數量
+
+private:
+    enum SlotState : uint8_t
+    {
+        SLOT_FREE,
+        SLOT_QUEUED,   // 尚未送出
+        SLOT_INFLIGHT, // 已送出，等待 PUBACK
+        SLOT_RESEND,   // 連線中斷，等待以 DUP 重送
+        SLOT_ACKED     // 已確認，等待從佇列前端移除
+    };
+
+    MQTTOutboundMessage slots[MQTT_RETRY_STORE_SIZE];
+    SlotState states[MQTT_RETRY_STORE_SIZE];
+    size_t head;  // 最舊訊息的位置
+    size_t count; // 佇列中（含已確認但未移除）的訊息數量
+    size_t unacked;
+    uint8_t window;
+    uint16_t next_packet_id;
+
+    size_t slotAt(size_t index) const;
+    uint16_t allocatePacketId();
+    void releaseAcked();
+};
+
+/**
+ * 將訊息組成 QoS 1 PUBLISH 封包（含 DUP / RETAIN 旗標）寫入 out，
+ * out 會先清空，重複使用同一個字串可避免每次配置。
+ */
+void mqttEncodePublish(const MQTTOutboundMessage &msg, std::string &out);
+
+/**
+ * 掃描從 Broker 收到的位元組流，辨識 PUBACK 封包並取出 Packet ID。
+ * 其餘封包僅略過，不影響 PubSubClient 自身的解析。
+ */
+class MQTTPubackScanner
+{
+public:
+    MQTTPubackScanner();
+    void reset();                                // 新連線開始時呼叫
+    bool feed(uint8_t byte, uint16_t &packet_id); // 完成一個 PUBACK 時回傳 true
+
+private:
+    enum ScanState : uint8_t
+    {
+        SCAN_HEADER,
+        SCAN_LENGTH,
+        SCAN_BODY
+    };
+
+    ScanState state;
+    uint8_t packet_type;
+    uint32_t remaining;
+    uint32_t length_multiplier;
+    uint32_t body_index;
+    uint16_t ack_id;
+};
+
+#endif // MQTT_INFLIGHT_H
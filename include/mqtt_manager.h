@@ -2,6 +2,11 @@
 #define MQTT_MANAGER_H
 
 #include <Arduino.h>
+#include <Client.h>
+#include <WiFiClient.h>
+#include <PubSubClient.h>
+
+#include "mqtt_inflight.h"
 
 /**
  * @file mqtt_manager.h
@@ -10,29 +15,95 @@
  * 功能:
  * - 連接到 MQTT Broker
  * - 訂閱控制主題
- * - 發布設備狀態
+ * - 發布設備狀態（QoS 0 / QoS 1）
  * - 接收和處理 MQTT 訊息
+ *
+ * PubSubClient 只支援 QoS 0 發布，QoS 1 由本模組自行組成 PUBLISH 封包，
+ * 並透過 MQTTAckTap 監看收到的位元組流以比對 PUBACK。
  */
 
+// PubSubClient 的收發緩衝區，收到超過此大小的訊息會被丟棄（OTA 分段約 1KB）
+#ifndef MQTT_BUFFER_SIZE
+#define MQTT_BUFFER_SIZE 1280
+#endif
+
+// 連線逾時，Broker 無回應時 loop() 最多阻塞這麼久（每 5 秒嘗試一次）
+#ifndef MQTT_CONNECT_TIMEOUT_MS
+#define MQTT_CONNECT_TIMEOUT_MS 1000
+#endif
+
+// 重新連線後自動重新訂閱的主題數量上限
+#ifndef MQTT_MAX_SUBSCRIPTIONS
+#define MQTT_MAX_SUBSCRIPTIONS 8
+#endif
+
 typedef void (*mqtt_callback_t)(const char *topic, const char *payload);
+typedef void (*mqtt_binary_callback_t)(const char *topic, const uint8_t *payload, unsigned int length); // 二進位訊息，例如 OTA 分段
+
+/**
+ * 包裝實際的網路 Client，將讀到的每個位元組交給 MQTTPubackScanner，
+ * 連線時套用 MQTT_CONNECT_TIMEOUT_MS，其餘行為與原本的 Client 相同。
+ */
+class MQTTAckTap : public Client
+{
+public:
+    MQTTAckTap(WiFiClient &inner, MQTTInflightWindow &window);
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char *host, uint16_t port) override;
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t *buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override;
+
+private:
+    WiFiClient &inner;
+    MQTTInflightWindow &window;
+    MQTTPubackScanner scanner;
+    void scan(uint8_t b);
+};
 
 class MQTTManager
 {
 public:
     MQTTManager();
     void init();
-    bool subscribe(const char *topic);
-    void publish(const char *topic, const char *payload, bool retain = false);
+    bool connect(const char *broker, uint16_t port, const char *client_id);
+    void setServer(const char *broker, uint16_t port, const char *client_id); // 只設定 Broker，由 loop() 連線；空字串表示不連線
+    bool subscribe(const char *topic, uint8_t qos = 0); // 重新連線後會自動重新訂閱
+    bool publish(const char *topic, const char *payload, bool retain = false, uint8_t qos = 0); // QoS 1 暫存區已滿時回傳 false
+    void setInflightWindow(uint8_t window); // QoS 1 同時在途訊息數量
+    size_t pendingCount();                  // 尚未收到 PUBACK 的 QoS 1 訊息數量
     bool isConnected();
     void setCallback(mqtt_callback_t callback);
+    void setBinaryCallback(mqtt_binary_callback_t callback);
     void loop();
     void disconnect();
 
 private:
     const char *broker_address;
+    uint16_t broker_port;
     const char *client_id;
     bool is_connected;
     mqtt_callback_t message_callback;
+    mqtt_binary_callback_t binary_callback;
+    String subscriptions[MQTT_MAX_SUBSCRIPTIONS];
+    uint8_t subscription_qos[MQTT_MAX_SUBSCRIPTIONS];
+    size_t subscription_count;
+    WiFiClient netClient;
+    MQTTInflightWindow inflight;
+    MQTTAckTap ackTap;
+    PubSubClient client;
+    unsigned long lastReconnectMillis; // 上次嘗試重新連線的時間 (ms)
+    std::string txBuffer;              // 組 QoS 1 PUBLISH 封包用，重複使用避免每次配置
+    bool reconnect();
+    void flushInflight();
+    bool writePublish(const MQTTOutboundMessage &msg);
 };
 
 #endif // MQTT_MANAGER_H
@@ -0,0 +1,72 @@
+#ifndef OTA_MANAGER_H
+#define OTA_MANAGER_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include <Preferences.h>
+
+/**
+ * @file ota_manager.h
+ * @brief OTA 管理模組 - 差異更新與自動回滾
+ *
+ * 功能:
+ * - 接收壓縮的 delta patch（HTTP 上傳、HTTP 下載或 MQTT 分段），格式見 delta_patch.h
+ * - 邊解壓邊套用，直接寫入非執行中的 OTA 分區，RAM 用量固定
+ * - 只接受以 ota_signing_key.h 公鑰簽章的 patch（ECDSA P-256），寫入 flash 前驗證
+ * - 切換前以 SHA-256 驗證舊映像與新映像
+ * - 新映像在時限內未通過健康檢查，或連續開機失敗時，自動切回舊分區
+ */
+
+#ifndef OTA_HEALTH_TIMEOUT_MS
+#define OTA_HEALTH_TIMEOUT_MS 120000 // 新映像需在此時間內通過健康檢查
+#endif
+
+#ifndef OTA_MAX_BOOT_ATTEMPTS
+#define OTA_MAX_BOOT_ATTEMPTS 3 // 未通過健康檢查的開機次數上限
+#endif
+
+#ifndef OTA_DOWNLOAD_IDLE_TIMEOUT_MS
+#define OTA_DOWNLOAD_IDLE_TIMEOUT_MS 10000 // 下載時超過此時間沒有收到資料就放棄
+#endif
+
+typedef bool (*ota_health_check_t)();
+
+class OTAManager
+{
+public:
+    OTAManager();
+    ~OTAManager();
+    void init(); // 開機時最先呼叫，檢查上次更新是否需要回滾
+    void loop(); // 健康檢查與更新後重新開機
+    void setHealthCheck(ota_health_check_t check);
+    bool begin();                                // 開始接收 patch
+    bool write(const uint8_t *data, size_t len); // 依序寫入 patch 片段
+    bool end();                                  // 驗證並切換開機分區，稍後自動重新開機
+    void abort();
+    bool applyFromUrl(const char *url); // 以 HTTP GET 下載 patch 並套用
+    // MQTT 分段：offset(u32 LE) + patch 片段；offset 0 開始新的更新，沒有資料的片段表示結束
+    // 只有造成失敗的片段回傳 false，之後的片段在下一個 offset 0 之前都會被略過
+    bool writeFragment(const uint8_t *payload, size_t len);
+    const char *lastError();
+    void registerRoutes(WebServer &server); // 註冊 /ota/delta
+
+private:
+    struct Session; // 更新期間才配置：解壓字典、patch 狀態、寫入緩衝
+    Session *session;
+    ota_health_check_t healthCheck;
+    bool pendingVerify;         // 目前執行的是尚未確認的新映像
+    unsigned long restartAt;    // 更新完成後預定重新開機的時間 (ms)，0 表示無
+    bool fragmentsDiscarded;    // MQTT 分段更新已失敗，等待下一個 offset 0
+    const char *errorMessage;
+    Preferences preferences;    // 用於保存回滾資訊
+    bool fail(const char *message);
+    bool startPatch();
+    bool applyFragment(uint32_t offset, const uint8_t *data, size_t len);
+    bool feedPatch(const uint8_t *data, size_t len);
+    void markHealthy();
+    void rollback(const char *reason);
+    static bool readOld(uint32_t offset, uint8_t *buf, size_t len, void *context);
+    static bool writeNew(const uint8_t *buf, size_t len, void *context);
+};
+
+#endif // OTA_MANAGER_H
@@ -0,0 +1,16 @@
+#ifndef OTA_SIGNING_KEY_H
+#define OTA_SIGNING_KEY_H
+
+#include <stdint.h>
+
+/**
+ * @file ota_signing_key.h
+ * @brief OTA patch 簽章公鑰（ECDSA P-256，未壓縮格式 0x04 | X | Y）
+ *
+ * 由 python3 scripts/delta_ota.py keygen <key.pem> 產生，私鑰不可加入版本控制。
+ * 全為 0 表示尚未設定，裝置會拒絕所有更新。
+ */
+
+static const uint8_t OTA_SIGNING_PUBLIC_KEY[65] = {0};
+
+#endif // OTA_SIGNING_KEY_H
@@ -6,6 +6,13 @@
 #include <WebServer.h>
 #include <Preferences.h>
 
+// 有儲存的帳密但超過此時間仍未連上，視為需要重新設定（啟動 BLE 設定）
+#ifndef WIFI_ASSOC_TIMEOUT_MS
+#define WIFI_ASSOC_TIMEOUT_MS 15000
+#endif
+
+typedef void (*web_route_hook_t)(WebServer &server); // 其他模組註冊 HTTP 路由用
+
 class WiFiManager
 {
 public:
@@ -20,6 +27,9 @@ public:
     void loop();             // 主循環處理
     void statusPinControl(); // 控制狀態指示燈
     void handleConnect();    // 處理 WiFi 連線事件
+    void setRouteHook(web_route_hook_t hook); // 設定頁與連線後的服務 Web Server 都會註冊這些路由
+    bool waitForConnection(uint32_t timeout_ms); // 等待連線並取得 IP，沒有儲存的帳密時立即回傳 false
+    bool needsProvisioning();                     // 沒有儲存的帳密，或斷線超過 WIFI_ASSOC_TIMEOUT_MS
 
 private:
     uint16_t dev_status_pin;       // 狀態指示燈腳位
@@ -30,6 +40,11 @@ private:
     unsigned long lastBlinkMillis; // 上次切換 LED 的時間 (ms)
     bool ledState;                 // LED 當前狀態 (true = HIGH)
     unsigned int blinkIntervalMs;  // 閃爍間隔 (毫秒)
+    web_route_hook_t routeHook;    // 額外路由註冊函式
+    bool serviceServer;            // webServer 是連上 WiFi 後的服務 Server（只有 routeHook 的路由）
+    bool hasCredentials;           // Preferences 中有 SSID 與密碼
+    unsigned long assocStartMillis; // 開始嘗試連線（或最後一次仍在線上）的時間 (ms)
+    void startServiceServer();
 };
 
 #endif
\ No newline at end of file
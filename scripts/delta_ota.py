@@ -0,0 +1,314 @@
+#!/usr/bin/env python3
+# 產生 / 套用韌體 delta patch，格式見 include/delta_patch.h
+#
+#   python3 scripts/delta_ota.py keygen ota_signing_key.pem
+#   python3 scripts/delta_ota.py diff  old.bin new.bin patch.bin --key ota_signing_key.pem
+#   python3 scripts/delta_ota.py apply old.bin patch.bin out.bin [--key ota_signing_key.pem]
+#
+# old.bin / new.bin 為 .pio/build/<env>/firmware.bin
+# 簽章以 openssl 命令列工具計算；裝置只接受以 keygen 寫入 include/ota_signing_key.h 的公鑰所簽的 patch
+import argparse
+import hashlib
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+import zlib
+
+MAGIC = b"PDLT"
+VERSION = 1
+FLAG_DEFLATE = 0x01
+FLAG_SIGNED = 0x02
+HEADER_SIZE = 80
+SIGNATURE_SIZE = 64
+KEY_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "include", "ota_signing_key.h")
+
+OP_END = 0x00
+OP_COPY = 0x01
+OP_ADD = 0x02
+OP_DIFF = 0x03
+
+KEY_SIZE = 8        # 比對用的區塊長度
+EXTEND_SLACK = 64   # 向後延伸時，分數連續未提升多少 bytes 就停止
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def zigzag(value):
+    return (value << 1) ^ (value >> 63) if value < 0 else value << 1
+
+
+def build_index(old):
+    index = {}
+    for pos in range(len(old) - KEY_SIZE + 1):
+        index.setdefault(old[pos:pos + KEY_SIZE], pos)
+    return index
+
+
+def extend_forward(old, new, old_pos, new_pos):
+    # 仿 bsdiff：以 2*相同 - 長度 為分數，容許位址等少量差異
+    limit = min(len(old) - old_pos, len(new) - new_pos)
+    same = best = best_len = 0
+    k = 0
+    while k < limit:
+        if old[old_pos + k] == new[new_pos + k]:
+            same += 1
+        k += 1
+        score = 2 * same - k
+        if score > best:
+            best, best_len = score, k
+        elif k - best_len > EXTEND_SLACK:
+            break
+    return best_len
+
+
+def extend_backward(old, new, old_pos, new_pos, lower):
+    limit = min(old_pos, new_pos - lower)
+    same = best = best_len = 0
+    k = 0
+    while k < limit:
+        k += 1
+        if old[old_pos - k] == new[new_pos - k]:
+            same += 1
+        score = 2 * same - k
+        if score > best:
+            best, best_len = score, k
+        elif k - best_len > EXTEND_SLACK:
+            break
+    return best_len
+
+
+def make_ops(old, new):
+    index = build_index(old)
+    ops = bytearray()
+    last_old = 0
+    literal = 0
+    i = 0
+    while i <= len(new) - KEY_SIZE:
+        match = index.get(new[i:i + KEY_SIZE])
+        if match is None:
+            i += 1
+            continue
+        length = extend_forward(old, new, match, i)
+        if length < KEY_SIZE:
+            i += 1
+            continue
+        back = extend_backward(old, new, match, i, literal)
+        start_old, start_new = match - back, i - back
+        length += back
+        if start_new > literal:
+            ops += bytes([OP_ADD]) + varint(start_new - literal) + new[literal:start_new]
+        diff = bytes((new[start_new + k] - old[start_old + k]) & 0xFF for k in range(length))
+        offset = varint(zigzag(start_old - last_old)) + varint(length)
+        if diff.count(0) == length:
+            ops += bytes([OP_COPY]) + offset
+        else:
+            ops += bytes([OP_DIFF]) + offset + diff
+        last_old = start_old + length
+        i = literal = start_new + length
+    if literal < len(new):
+        ops += bytes([OP_ADD]) + varint(len(new) - literal) + new[literal:]
+    ops.append(OP_END)
+    return bytes(ops)
+
+
+def openssl(*args, data=None):
+    return subprocess.run(("openssl",) + args, input=data, stdout=subprocess.PIPE, check=True).stdout
+
+
+def public_key(key_path):
+    # SubjectPublicKeyInfo 的最後 65 bytes 即為未壓縮的公鑰點 0x04 | X | Y
+    point = openssl("ec", "-in", key_path, "-pubout", "-outform", "DER")[-65:]
+    if point[0] != 0x04 or len(point) != 65:
+        raise ValueError("%s is not a P-256 key" % key_path)
+    return point
+
+
+def sign_header(header, key_path):
+    # openssl 輸出 DER: 30 len 02 rlen r 02 slen s，轉為固定長度的 r | s
+    der = openssl("dgst", "-sha256", "-sign", key_path, data=header)
+    pos = 2
+    values = []
+    for _ in range(2):
+        if der[pos] != 0x02:
+            raise ValueError("unexpected signature encoding")
+        length = der[pos + 1]
+        values.append(int.from_bytes(der[pos + 2:pos + 2 + length], "big"))
+        pos += 2 + length
+    return b"".join(v.to_bytes(32, "big") for v in values)
+
+
+def verify_header(header, signature, key_path):
+    def der_int(value):
+        raw = value.to_bytes(33, "big").lstrip(b"\x00")
+        if not raw or raw[0] & 0x80:
+            raw = b"\x00" + raw
+        return bytes([0x02, len(raw)]) + raw
+    body = der_int(int.from_bytes(signature[:32], "big")) + der_int(int.from_bytes(signature[32:], "big"))
+    with tempfile.TemporaryDirectory() as tmp:
+        pub = os.path.join(tmp, "pub.pem")
+        sig = os.path.join(tmp, "sig.der")
+        open(pub, "wb").write(openssl("ec", "-in", key_path, "-pubout"))
+        open(sig, "wb").write(bytes([0x30, len(body)]) + body)
+        result = subprocess.run(["openssl", "dgst", "-sha256", "-verify", pub, "-signature", sig],
+                                input=header, stdout=subprocess.PIPE)
+    return result.returncode == 0
+
+
+def write_key_header(point, path):
+    rows = ",\n".join("    " + ", ".join("0x%02x" % b for b in point[i:i + 13]) for i in range(0, len(point), 13))
+    with open(path, "w") as f:
+        f.write(KEY_HEADER_TEMPLATE % rows)
+
+
+KEY_HEADER_TEMPLATE = """#ifndef OTA_SIGNING_KEY_H
+#define OTA_SIGNING_KEY_H
+
+#include <stdint.h>
+
+/**
+ * @file ota_signing_key.h
+ * @brief OTA patch 簽章公鑰（ECDSA P-256，未壓縮格式 0x04 | X | Y）
+ *
+ * 由 python3 scripts/delta_ota.py keygen <key.pem> 產生，私鑰不可加入版本控制。
+ * 全為 0 表示尚未設定，裝置會拒絕所有更新。
+ */
+
+static const uint8_t OTA_SIGNING_PUBLIC_KEY[65] = {
+%s};
+
+#endif // OTA_SIGNING_KEY_H
+"""
+
+
+def make_patch(old, new, compress=True, key_path=None):
+    ops = make_ops(old, new)
+    flags = 0
+    if compress:
+        packer = zlib.compressobj(9, zlib.DEFLATED, -15)  # raw deflate，裝置端以 ROM tinfl 解壓
+        ops = packer.compress(ops) + packer.flush()
+        flags |= FLAG_DEFLATE
+    if key_path:
+        flags |= FLAG_SIGNED
+    header = MAGIC + struct.pack("<BBHII", VERSION, flags, 0, len(old), len(new))
+    header += hashlib.sha256(old).digest() + hashlib.sha256(new).digest()
+    signature = sign_header(header, key_path) if key_path else b""
+    return header + signature + ops
+
+
+def read_varint(data, pos):
+    value = shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def apply_patch(old, patch, key_path=None):
+    # 參考實作，用於驗證 diff 結果；裝置端為 DeltaPatchApplier
+    if patch[:4] != MAGIC or patch[4] != VERSION:
+        raise ValueError("not a delta patch")
+    flags = patch[5]
+    old_size, new_size = struct.unpack_from("<II", patch, 8)
+    if old_size != len(old) or hashlib.sha256(old).digest() != patch[16:48]:
+        raise ValueError("patch does not match the old image")
+    data_offset = HEADER_SIZE + (SIGNATURE_SIZE if flags & FLAG_SIGNED else 0)
+    if key_path:
+        if not flags & FLAG_SIGNED:
+            raise ValueError("patch is not signed")
+        if not verify_header(patch[:HEADER_SIZE], patch[HEADER_SIZE:data_offset], key_path):
+            raise ValueError("bad patch signature")
+    ops = patch[data_offset:]
+    if flags & FLAG_DEFLATE:
+        ops = zlib.decompress(ops, -15)
+    out = bytearray()
+    last_old = pos = 0
+    while True:
+        op = ops[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        if op == OP_ADD:
+            length, pos = read_varint(ops, pos)
+            out += ops[pos:pos + length]
+            pos += length
+            continue
+        delta, pos = read_varint(ops, pos)
+        length, pos = read_varint(ops, pos)
+        last_old += (delta >> 1) ^ -(delta & 1)
+        if op == OP_COPY:
+            out += old[last_old:last_old + length]
+        elif op == OP_DIFF:
+            out += bytes((old[last_old + k] + ops[pos + k]) & 0xFF for k in range(length))
+            pos += length
+        else:
+            raise ValueError("bad op 0x%02x" % op)
+        last_old += length
+    if len(out) != new_size or hashlib.sha256(out).digest() != patch[48:80]:
+        raise ValueError("patched image hash mismatch")
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pulmote delta OTA patch tool")
+    sub = parser.add_subparsers(dest="command", required=True)
+    keygen = sub.add_parser("keygen", help="create a signing key (if missing) and write its public key header")
+    keygen.add_argument("key")
+    keygen.add_argument("--header", default=KEY_HEADER, help="public key header to write")
+    diff = sub.add_parser("diff", help="create a patch from old.bin to new.bin")
+    diff.add_argument("old")
+    diff.add_argument("new")
+    diff.add_argument("patch")
+    diff.add_argument("--no-compress", action="store_true", help="leave the op stream uncompressed")
+    diff.add_argument("--key", help="sign the patch with this P-256 private key (required by the device)")
+    apply = sub.add_parser("apply", help="apply a patch on the host and verify hashes")
+    apply.add_argument("old")
+    apply.add_argument("patch")
+    apply.add_argument("out")
+    apply.add_argument("--key", help="also verify the signature with this key")
+    args = parser.parse_args()
+
+    if args.command == "keygen":
+        if not os.path.exists(args.key):
+            openssl("ecparam", "-name", "prime256v1", "-genkey", "-noout", "-out", args.key)
+            os.chmod(args.key, 0o600)
+            print("created %s, keep it out of version control" % args.key)
+        write_key_header(public_key(args.key), args.header)
+        print("wrote public key to %s" % os.path.normpath(args.header))
+    elif args.command == "diff":
+        old = open(args.old, "rb").read()
+        new = open(args.new, "rb").read()
+        start = time.time()
+        patch = make_patch(old, new, not args.no_compress, args.key)
+        elapsed = time.time() - start
+        open(args.patch, "wb").write(patch)
+        print("old=%d new=%d patch=%d (%.1f%% of new) in %.1f s" %
+              (len(old), len(new), len(patch), 100.0 * len(patch) / max(len(new), 1), elapsed))
+    else:
+        old = open(args.old, "rb").read()
+        patch = open(args.patch, "rb").read()
+        start = time.time()
+        out = apply_patch(old, patch, args.key)
+        elapsed = time.time() - start
+        open(args.out, "wb").write(out)
+        print("applied %d bytes in %.2f s, sha256 ok%s" % (len(out), elapsed, ", signature ok" if args.key else ""))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,43 @@
+# 編譯完成後列出 Flash / RAM 用量，並累積到 .pio/size_report.csv 方便比較各 env
+import csv
+import os
+import subprocess
+
+Import("env")
+
+# ESP32 各 section 歸類
+FLASH_SECTIONS = (".flash.text", ".flash.rodata", ".flash.appdesc", ".iram0.vectors", ".iram0.text", ".dram0.data")
+DRAM_SECTIONS = (".dram0.data", ".dram0.bss", ".noinit")
+IRAM_SECTIONS = (".iram0.vectors", ".iram0.text")
+
+
+def size_report(source, target, env):
+    elf = target[0].get_abspath()
+    output = subprocess.check_output([env.subst("$SIZETOOL"), "-A", "-d", elf], universal_newlines=True)
+    sections = {}
+    for line in output.splitlines():
+        parts = line.split()
+        if len(parts) >= 2 and parts[0].startswith(".") and parts[1].isdigit():
+            sections[parts[0]] = int(parts[1])
+
+    flash = sum(sections.get(name, 0) for name in FLASH_SECTIONS)
+    dram = sum(sections.get(name, 0) for name in DRAM_SECTIONS)
+    iram = sum(sections.get(name, 0) for name in IRAM_SECTIONS)
+    name = env.subst("$PIOENV")
+    print("Size report [%s]: flash=%d bytes, dram=%d bytes, iram=%d bytes" % (name, flash, dram, iram))
+
+    report = os.path.join(env.subst("$PROJECT_WORKSPACE_DIR"), "size_report.csv")
+    rows = {}
+    if os.path.isfile(report):
+        with open(report) as f:
+            for row in csv.DictReader(f):
+                rows[row["env"]] = row
+    rows[name] = {"env": name, "flash": flash, "dram": dram, "iram": iram}
+    with open(report, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=["env", "flash", "dram", "iram"])
+        writer.writeheader()
+        for key in sorted(rows):
+            writer.writerow(rows[key])
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", size_report)
@@ -1,17 +1,35 @@
 // BLEManager 模組 Source
+#include "board_config.h"
+#if PULMOTE_ENABLE_BLE
 #include "ble_manager.h"
 
 BLEManager::BLEManager()
 {
     // 建構子初始化
+    pServer = nullptr;
+    pRxCharacteristic = nullptr;
+    pTxCharacteristic = nullptr;
+    initialized = false;
 }
 
 void BLEManager::init()
 {
+    if (initialized)
+        return;
     // 藍牙初始化流程
+    initialized = true;
 }
 
 void BLEManager::loop()
 {
+    if (!initialized)
+        return; // BLE 為延遲啟動，第一次使用前不處理
     // 藍牙狀態循環處理
 }
+
+bool BLEManager::isInitialized()
+{
+    return initialized;
+}
+
+#endif // PULMOTE_ENABLE_BLE
@@ -0,0 +1,144 @@
+// BootOrchestrator 模組 Source
+#include "boot_orchestrator.h"
+
+BootOrchestrator::BootOrchestrator()
+{
+    doneQueue = nullptr;
+    bootStartUs = 0;
+    readyUs = 0;
+    finishedUs = 0;
+}
+
+bool BootOrchestrator::add(const char *name, boot_fn_t fn, const char *deps, bool lazy, bool background)
+{
+    return schedule.add(name, fn, deps, lazy, background) >= 0;
+}
+
+void BootOrchestrator::taskEntry(void *arg)
+{
+    TaskArg *task = static_cast<TaskArg *>(arg);
+    DoneEvent done;
+    done.index = task->index;
+    done.start_us = micros();
+    task->self->schedule.task(task->index).fn();
+    done.end_us = micros();
+    xQueueSend(task->self->doneQueue, &done, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
+
+void BootOrchestrator::startReady() // 相依已完成的模組全部同時啟動
+{
+    int index;
+    while ((index = schedule.nextReady(micros())) >= 0)
+    {
+        args[index].self = this;
+        args[index].index = index;
+        const BootTaskInfo &t = schedule.task(index);
+        if (xTaskCreate(taskEntry, t.name, BOOT_TASK_STACK, &args[index], 1, NULL) != pdPASS)
+        {
+            // 無法建立 task 時改為直接執行
+            uint32_t start = micros();
+            t.fn();
+            schedule.markDone(index, start, micros());
+        }
+    }
+}
+
+bool BootOrchestrator::run()
+{
+    bootStartUs = micros();
+    if (!schedule.resolve())
+    {
+        Serial.println("BootOrchestrator: invalid module dependencies");
+        return false;
+    }
+    doneQueue = xQueueCreate(BOOT_MAX_TASKS, sizeof(DoneEvent));
+    while (!schedule.foregroundFinished())
+    {
+        startReady();
+        if (schedule.foregroundFinished() || schedule.running() == 0)
+            continue; // 剛才直接執行完成，重新檢查
+        DoneEvent done;
+        xQueueReceive(doneQueue, &done, portMAX_DELAY);
+        schedule.markDone(done.index, done.start_us, done.end_us);
+    }
+    startReady(); // 已完成的 background 模組可能讓其他模組就緒
+    readyUs = micros();
+    if (schedule.finished())
+        finish();
+    return true;
+}
+
+void BootOrchestrator::poll()
+{
+    if (!doneQueue)
+        return;
+    DoneEvent done;
+    while (xQueueReceive(doneQueue, &done, 0) == pdTRUE)
+    {
+        schedule.markDone(done.index, done.start_us, done.end_us);
+        printTask(done.index);
+    }
+    startReady();
+    if (schedule.finished())
+    {
+        finish();
+        Serial.printf("Boot: all modules ready after %lu us (%lu us since reset)\n",
+                      (unsigned long)(finishedUs - bootStartUs), (unsigned long)finishedUs);
+    }
+}
+
+void BootOrchestrator::finish()
+{
+    vQueueDelete(doneQueue);
+    doneQueue = nullptr;
+    finishedUs = micros();
+}
+
+bool BootOrchestrator::ensure(const char *name)
+{
+    int index = schedule.find(name);
+    if (index < 0)
+        return false;
+    const BootTaskInfo &t = schedule.task(index);
+    if (t.state != BootTaskInfo::PENDING)
+        return true;
+    uint32_t start = micros();
+    if (!schedule.startLazy(index, start))
+        return false; // 相依模組尚未完成
+    t.fn();
+    schedule.markDone(index, start, micros());
+    Serial.printf("Boot: %s started on first use (%lu us)\n", t.name, (unsigned long)(t.end_us - t.start_us));
+    return true;
+}
+
+bool BootOrchestrator::isDone(const char *name) const
+{
+    int index = schedule.find(name);
+    return index >= 0 && schedule.task(index).state == BootTaskInfo::DONE;
+}
+
+void BootOrchestrator::printTask(size_t index)
+{
+    const BootTaskInfo &t = schedule.task(index);
+    if (t.state != BootTaskInfo::DONE)
+    {
+        Serial.printf("Boot: %-6s %s\n", t.name,
+                      t.lazy ? "lazy, not started" : (t.background ? "background, not finished" : "not finished"));
+        return;
+    }
+    Serial.printf("Boot: %-6s +%7lu us .. +%7lu us (%lu us)\n", t.name,
+                  (unsigned long)(t.start_us - bootStartUs), (unsigned long)(t.end_us - bootStartUs),
+                  (unsigned long)(t.end_us - t.start_us));
+}
+
+void BootOrchestrator::printTimeline()
+{
+    for (size_t i = 0; i < schedule.count(); ++i)
+        printTask(i);
+    Serial.printf("Boot: ready after %lu us (%lu us since reset)\n",
+                  (unsigned long)(readyUs - bootStartUs), (unsigned long)readyUs);
+    if (finishedUs)
+        Serial.printf("Boot: all modules ready after %lu us (%lu us since reset)\n",
+                      (unsigned long)(finishedUs - bootStartUs), (unsigned long)finishedUs);
+}
@@ -0,0 +1,178 @@
+// 開機排程 Source
+#include "boot_schedule.h"
+#include <string.h>
+
+BootSchedule::BootSchedule()
+{
+    task_count = 0;
+    done_mask = 0;
+    resolved = false;
+}
+
+int BootSchedule::add(const char *name, boot_fn_t fn, const char *deps, bool lazy, bool background)
+{
+    if (task_count >= BOOT_MAX_TASKS || find(name) >= 0)
+        return -1;
+    BootTaskInfo &t = tasks[task_count];
+    t.name = name;
+    t.fn = fn;
+    t.dep_names = deps ? deps : "";
+    t.deps = 0;
+    t.lazy = lazy;
+    t.background = background;
+    background_declared[task_count] = background;
+    t.state = BootTaskInfo::PENDING;
+    t.start_us = 0;
+    t.end_us = 0;
+    resolved = false;
+    return (int)task_count++;
+}
+
+bool BootSchedule::resolve()
+{
+    // 名稱轉為位元遮罩
+    for (size_t i = 0; i < task_count; ++i)
+    {
+        BootTaskInfo &t = tasks[i];
+        t.deps = 0;
+        const char *p = t.dep_names;
+        while (*p)
+        {
+            const char *end = strchr(p, ',');
+            size_t length = end ? (size_t)(end - p) : strlen(p);
+            if (length > 0)
+            {
+                int dep = findName(p, length);
+                if (dep < 0 || dep == (int)i)
+                    return false;
+                if (!t.lazy && tasks[dep].lazy)
+                    return false; // 開機階段會永遠等不到 lazy 模組
+                t.deps |= 1u << dep;
+            }
+            p += length;
+            if (*p == ',')
+                ++p;
+        }
+    }
+    // 拓撲排序檢查循環相依，同時讓相依 background 模組的模組也成為 background
+    uint32_t visited = 0;
+    bool progress = true;
+    for (size_t i = 0; i < task_count; ++i)
+        tasks[i].background = background_declared[i];
+    while (progress)
+    {
+        progress = false;
+        for (size_t i = 0; i < task_count; ++i)
+        {
+            uint32_t bit = 1u << i;
+            if (!(visited & bit) && (tasks[i].deps & ~visited) == 0)
+            {
+                for (size_t dep = 0; dep < task_count; ++dep)
+                {
+                    if ((tasks[i].deps & (1u << dep)) && tasks[dep].background)
+                        tasks[i].background = true;
+                }
+                visited |= bit;
+                progress = true;
+            }
+        }
+    }
+    resolved = visited == (task_count ? (uint32_t)((1ull << task_count) - 1) : 0);
+    return resolved;
+}
+
+int BootSchedule::nextReady(uint32_t now_us)
+{
+    if (!resolved)
+        return -1;
+    for (size_t i = 0; i < task_count; ++i)
+    {
+        BootTaskInfo &t = tasks[i];
+        if (!t.lazy && t.state == BootTaskInfo::PENDING && (t.deps & ~done_mask) == 0)
+        {
+            t.state = BootTaskInfo::RUNNING;
+            t.start_us = now_us;
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+bool BootSchedule::startLazy(int index, uint32_t now_us)
+{
+    if (!resolved || index < 0 || (size_t)index >= task_count)
+        return false;
+    BootTaskInfo &t = tasks[index];
+    if (t.state != BootTaskInfo::PENDING || (t.deps & ~done_mask) != 0)
+        return false;
+    t.state = BootTaskInfo::RUNNING;
+    t.start_us = now_us;
+    return true;
+}
+
+void BootSchedule::markDone(int index, uint32_t start_us, uint32_t end_us)
+{
+    if (index < 0 || (size_t)index >= task_count)
+        return;
+    BootTaskInfo &t = tasks[index];
+    t.state = BootTaskInfo::DONE;
+    t.start_us = start_us;
+    t.end_us = end_us;
+    done_mask |= 1u << index;
+}
+
+bool BootSchedule::finished() const
+{
+    for (size_t i = 0; i < task_count; ++i)
+    {
+        if (!tasks[i].lazy && tasks[i].state != BootTaskInfo::DONE)
+            return false;
+    }
+    return true;
+}
+
+bool BootSchedule::foregroundFinished() const
+{
+    for (size_t i = 0; i < task_count; ++i)
+    {
+        if (!tasks[i].lazy && !tasks[i].background && tasks[i].state != BootTaskInfo::DONE)
+            return false;
+    }
+    return true;
+}
+
+size_t BootSchedule::running() const
+{
+    size_t n = 0;
+    for (size_t i = 0; i < task_count; ++i)
+    {
+        if (tasks[i].state == BootTaskInfo::RUNNING)
+            ++n;
+    }
+    return n;
+}
+
+int BootSchedule::find(const char *name) const
+{
+    return findName(name, strlen(name));
+}
+
+size_t BootSchedule::count() const
+{
+    return task_count;
+}
+
+const BootTaskInfo &BootSchedule::task(size_t index) const
+{
+    return tasks[index];
+}
+
+int BootSchedule::findName(const char *name, size_t length) const
+{
+    for (size_t i = 0; i < task_count; ++i)
+    {
+        if (strlen(tasks[i].name) == length && strncmp(tasks[i].name, name, length) == 0)
+            return (int)i;
+    }
+    return -1;
+}
@@ -0,0 +1,212 @@
+// 韌體差異更新 Source
+#include "delta_patch.h"
+#include <string.h>
+
+#define DELTA_OP_END 0x00
+#define DELTA_OP_COPY 0x01
+#define DELTA_OP_ADD 0x02
+#define DELTA_OP_DIFF 0x03
+
+static const uint8_t kPatchMagic[4] = {'P', 'D', 'L', 'T'};
+
+static uint32_t getU32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool deltaPatchParseHeader(const uint8_t *data, DeltaPatchHeader &header)
+{
+    if (memcmp(data, kPatchMagic, 4) != 0 || data[4] != DELTA_PATCH_VERSION)
+        return false;
+    header.flags = data[5];
+    header.old_size = getU32(data + 8);
+    header.new_size = getU32(data + 12);
+    memcpy(header.old_sha256, data + 16, 32);
+    memcpy(header.new_sha256, data + 48, 32);
+    return true;
+}
+
+size_t deltaPatchDataOffset(const DeltaPatchHeader &header)
+{
+    return DELTA_PATCH_HEADER_SIZE + ((header.flags & DELTA_FLAG_SIGNED) ? DELTA_PATCH_SIGNATURE_SIZE : 0);
+}
+
+DeltaPatchApplier::DeltaPatchApplier()
+{
+    begin(0, 0, nullptr, nullptr, nullptr);
+}
+
+void DeltaPatchApplier::begin(uint32_t old_len, uint32_t new_len, delta_read_old_t read_fn, delta_write_new_t write_fn, void *ctx)
+{
+    read_old = read_fn;
+    write_new = write_fn;
+    context = ctx;
+    old_size = old_len;
+    new_size = new_len;
+    out_pos = 0;
+    old_pos = 0;
+    remaining = 0;
+    varint = 0;
+    varint_shift = 0;
+    op = DELTA_OP_END;
+    phase = PHASE_OP;
+    last_status = DELTA_NEED_MORE;
+}
+
+DeltaPatchStatus DeltaPatchApplier::status() const
+{
+    return last_status;
+}
+
+uint32_t DeltaPatchApplier::written() const
+{
+    return out_pos;
+}
+
+bool DeltaPatchApplier::readVarint(uint8_t byte, bool &complete)
+{
+    if (varint_shift > 28)
+        return false; // 超過 32 bits
+    varint |= (uint32_t)(byte & 0x7F) << varint_shift;
+    varint_shift += 7;
+    complete = (byte & 0x80) == 0;
+    return true;
+}
+
+DeltaPatchStatus DeltaPatchApplier::copyOld()
+{
+    // COPY 不需要輸入資料，以固定大小的視窗分段搬移
+    while (remaining > 0)
+    {
+        size_t n = remaining < DELTA_PATCH_WINDOW ? remaining : DELTA_PATCH_WINDOW;
+        if (!read_old(old_pos, window, n, context) || !write_new(window, n, context))
+            return DELTA_IO_ERROR;
+        old_pos += n;
+        out_pos += n;
+        remaining -= n;
+    }
+    phase = PHASE_OP;
+    return DELTA_NEED_MORE;
+}
+
+DeltaPatchStatus DeltaPatchApplier::startData()
+{
+    if (remaining > new_size - out_pos)
+        return DELTA_OUT_OF_RANGE;
+    if (op != DELTA_OP_ADD && remaining > old_size - old_pos)
+        return DELTA_OUT_OF_RANGE;
+    if (op == DELTA_OP_COPY)
+        return copyOld();
+    phase = remaining > 0 ? PHASE_DATA : PHASE_OP;
+    return DELTA_NEED_MORE;
+}
+
+DeltaPatchStatus DeltaPatchApplier::feed(const uint8_t *data, size_t len)
+{
+    size_t pos = 0;
+    while (pos < len && last_status == DELTA_NEED_MORE)
+    {
+        switch (phase)
+        {
+        case PHASE_OP:
+            op = data[pos++];
+            varint = 0;
+            varint_shift = 0;
+            if (op == DELTA_OP_END)
+                last_status = out_pos == new_size ? DELTA_DONE : DELTA_OUT_OF_RANGE;
+            else if (op == DELTA_OP_COPY || op == DELTA_OP_DIFF)
+                phase = PHASE_OFFSET;
+            else if (op == DELTA_OP_ADD)
+                phase = PHASE_LENGTH;
+            else
+                last_status = DELTA_BAD_OP;
+            break;
+        case PHASE_OFFSET:
+        {
+            bool complete;
+            if (!readVarint(data[pos++], complete))
+            {
+                last_status = DELTA_BAD_OP;
+                break;
+            }
+            if (!complete)
+                break;
+            // zigzag 解碼為有號差值
+            int64_t target = (int64_t)old_pos + (int32_t)((varint >> 1) ^ (0u - (varint & 1)));
+            if (target < 0 || target > (int64_t)old_size)
+            {
+                last_status = DELTA_OUT_OF_RANGE;
+                break;
+            }
+            old_pos = (uint32_t)target;
+            varint = 0;
+            varint_shift = 0;
+            phase = PHASE_LENGTH;
+            break;
+        }
+        case PHASE_LENGTH:
+        {
+            bool complete;
+            if (!readVarint(data[pos++], complete))
+            {
+                last_status = DELTA_BAD_OP;
+                break;
+            }
+            if (!complete)
+                break;
+            remaining = varint;
+            last_status = startData();
+            break;
+        }
+        case PHASE_DATA:
+        {
+            size_t n = len - pos;
+            if (n > remaining)
+                n = remaining;
+            if (op == DELTA_OP_ADD)
+            {
+                if (!write_new(data + pos, n, context))
+                {
+                    last_status = DELTA_IO_ERROR;
+                    break;
+                }
+            }
+            else
+            {
+                // DIFF：舊映像加上差值，差值多為 0，壓縮後很小
+                for (size_t done = 0; done < n;)
+                {
+                    size_t m = n - done;
+                    if (m > DELTA_PATCH_WINDOW)
+                        m = DELTA_PATCH_WINDOW;
+                    if (!read_old(old_pos, window, m, context))
+                    {
+                        last_status = DELTA_IO_ERROR;
+                        break;
+                    }
+                    for (size_t i = 0; i < m; ++i)
+                        window[i] = (uint8_t)(window[i] + data[pos + done + i]);
+                    if (!write_new(window, m, context))
+                    {
+                        last_status = DELTA_IO_ERROR;
+                        break;
+                    }
+                    old_pos += m;
+                    done += m;
+                }
+                if (last_status != DELTA_NEED_MORE)
+                    break;
+            }
+            pos += n;
+            out_pos += n;
+            remaining -= n;
+            if (remaining == 0)
+                phase = PHASE_OP;
+            break;
+        }
+        }
+    }
+    if (pos < len && last_status == DELTA_DONE)
+        last_status = DELTA_TRAILING_DATA;
+    return last_status;
+}
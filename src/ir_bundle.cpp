@@ -0,0 +1,268 @@
+// 紅外線指令庫備份格式 Source
+#include "board_config.h"
+#if PULMOTE_ENABLE_IR
+#include "ir_bundle.h"
+#include <string.h>
+
+static const uint8_t kHeaderMagic[4] = {'P', 'I', 'R', 'B'};
+static const uint8_t kTrailerMagic[4] = {'P', 'I', 'R', 'E'};
+
+// 半位元組查表，只佔 64 bytes，速度足以應付串流
+static const uint32_t kCrcNibble[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+uint32_t irBundleCrc32(uint32_t crc, const uint8_t *data, size_t length)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ kCrcNibble[crc & 0x0F];
+        crc = (crc >> 4) ^ kCrcNibble[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+bool irBundleValidName(const char *name, size_t length)
+{
+    if (length == 0 || length > IR_BUNDLE_MAX_NAME)
+        return false;
+    for (size_t i = 0; i < length; ++i)
+    {
+        char c = name[i];
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+static void putU16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void putU32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t getU16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+IRBundleWriter::IRBundleWriter()
+{
+    frame_len = 0;
+    frame_pos = 0;
+    records = 0;
+    body_crc = 0;
+}
+
+void IRBundleWriter::begin(uint32_t record_count)
+{
+    memcpy(frame, kHeaderMagic, 4);
+    frame[4] = IR_BUNDLE_VERSION;
+    frame[5] = 0;
+    putU16(frame + 6, 0);
+    putU32(frame + 8, record_count);
+    putU32(frame + 12, irBundleCrc32(0, frame, 12));
+    frame_len = IR_BUNDLE_HEADER_SIZE;
+    frame_pos = 0;
+    records = 0;
+    body_crc = 0;
+}
+
+uint8_t *IRBundleWriter::beginRecord(const char *name, uint16_t sample_count)
+{
+    size_t name_len = strlen(name);
+    if (!drained() || !irBundleValidName(name, name_len) || sample_count > IR_BUNDLE_MAX_SAMPLES)
+        return nullptr;
+    frame[0] = (uint8_t)name_len;
+    frame[1] = 0;
+    putU16(frame + 2, sample_count);
+    memcpy(frame + 4, name, name_len);
+    frame_len = 4 + name_len + (size_t)sample_count * 2;
+    frame_pos = frame_len; // commitRecord() 之前不可讀出
+    return frame + 4 + name_len;
+}
+
+void IRBundleWriter::commitRecord()
+{
+    putU32(frame + frame_len, irBundleCrc32(0, frame, frame_len));
+    frame_len += 4;
+    frame_pos = 0;
+    body_crc = irBundleCrc32(body_crc, frame, frame_len);
+    ++records;
+}
+
+void IRBundleWriter::finish()
+{
+    memcpy(frame, kTrailerMagic, 4);
+    putU32(frame + 4, records);
+    putU32(frame + 8, body_crc);
+    frame_len = IR_BUNDLE_TRAILER_SIZE;
+    frame_pos = 0;
+}
+
+size_t IRBundleWriter::read(uint8_t *buf, size_t len)
+{
+    size_t n = frame_len - frame_pos;
+    if (n > len)
+        n = len;
+    memcpy(buf, frame + frame_pos, n);
+    frame_pos += n;
+    return n;
+}
+
+bool IRBundleWriter::drained() const
+{
+    return frame_pos >= frame_len;
+}
+
+uint32_t IRBundleWriter::recordsWritten() const
+{
+    return records;
+}
+
+IRBundleReader::IRBundleReader()
+{
+    begin();
+}
+
+void IRBundleReader::begin()
+{
+    frame_len = 0;
+    frame_need = IR_BUNDLE_HEADER_SIZE;
+    phase = PHASE_HEADER;
+    last_status = IR_BUNDLE_NEED_MORE;
+    committed.offset = 0;
+    committed.records = 0;
+    committed.record_count = 0;
+    committed.body_crc = 0;
+}
+
+bool IRBundleReader::resume(const IRBundleCheckpoint &state)
+{
+    begin();
+    if (state.offset < IR_BUNDLE_HEADER_SIZE || state.records > state.record_count)
+        return false; // 標頭尚未驗證過，只能從頭開始
+    committed = state;
+    phase = committed.records < committed.record_count ? PHASE_RECORD_HEAD : PHASE_TRAILER;
+    frame_need = phase == PHASE_RECORD_HEAD ? 4 : IR_BUNDLE_TRAILER_SIZE;
+    return true;
+}
+
+IRBundleCheckpoint IRBundleReader::checkpoint() const
+{
+    return committed;
+}
+
+IRBundleStatus IRBundleReader::status() const
+{
+    return last_status;
+}
+
+IRBundleStatus IRBundleReader::feed(const uint8_t *data, size_t len, ir_bundle_record_cb_t callback, void *context)
+{
+    size_t pos = 0;
+    while (pos < len && last_status == IR_BUNDLE_NEED_MORE)
+    {
+        size_t n = frame_need - frame_len;
+        if (n > len - pos)
+            n = len - pos;
+        memcpy(frame + frame_len, data + pos, n);
+        frame_len += n;
+        pos += n;
+        if (frame_len == frame_need)
+            last_status = completeFrame(callback, context);
+    }
+    if (pos < len && last_status == IR_BUNDLE_DONE)
+        last_status = IR_BUNDLE_TRAILING_DATA;
+    return last_status;
+}
+
+IRBundleStatus IRBundleReader::completeFrame(ir_bundle_record_cb_t callback, void *context)
+{
+    switch (phase)
+    {
+    case PHASE_HEADER:
+        if (memcmp(frame, kHeaderMagic, 4) != 0)
+            return IR_BUNDLE_BAD_MAGIC;
+        if (getU32(frame + 12) != irBundleCrc32(0, frame, 12))
+            return IR_BUNDLE_BAD_CRC;
+        if (frame[4] != IR_BUNDLE_VERSION)
+            return IR_BUNDLE_BAD_VERSION;
+        committed.record_count = getU32(frame + 8);
+        committed.offset = IR_BUNDLE_HEADER_SIZE;
+        break;
+    case PHASE_RECORD_HEAD:
+    {
+        uint8_t name_len = frame[0];
+        uint16_t sample_count = getU16(frame + 2);
+        if (name_len == 0 || name_len > IR_BUNDLE_MAX_NAME || sample_count > IR_BUNDLE_MAX_SAMPLES)
+            return IR_BUNDLE_BAD_RECORD;
+        frame_need = 4 + name_len + (size_t)sample_count * 2 + 4;
+        phase = PHASE_RECORD_BODY;
+        return IR_BUNDLE_NEED_MORE; // 保留紀錄標頭，繼續讀取同一個 frame
+    }
+    case PHASE_RECORD_BODY:
+    {
+        size_t body = frame_len - 4;
+        if (getU32(frame + body) != irBundleCrc32(0, frame, body))
+            return IR_BUNDLE_BAD_CRC;
+        IRBundleRecord record;
+        record.name = reinterpret_cast<const char *>(frame + 4);
+        record.name_len = frame[0];
+        record.sample_count = getU16(frame + 2);
+        record.samples = frame + 4 + record.name_len;
+        if (!irBundleValidName(record.name, record.name_len))
+            return IR_BUNDLE_BAD_RECORD;
+        if (callback && !callback(record, context))
+            return IR_BUNDLE_REJECTED;
+        committed.body_crc = irBundleCrc32(committed.body_crc, frame, frame_len);
+        committed.offset += frame_len;
+        ++committed.records;
+        break;
+    }
+    case PHASE_TRAILER:
+        if (memcmp(frame, kTrailerMagic, 4) != 0)
+            return IR_BUNDLE_BAD_MAGIC;
+        if (getU32(frame + 4) != committed.records || committed.records != committed.record_count)
+            return IR_BUNDLE_BAD_COUNT;
+        if (getU32(frame + 8) != committed.body_crc)
+            return IR_BUNDLE_BAD_CRC;
+        committed.offset += IR_BUNDLE_TRAILER_SIZE;
+        phase = PHASE_END;
+        frame_len = 0;
+        return IR_BUNDLE_DONE;
+    case PHASE_END:
+        return IR_BUNDLE_TRAILING_DATA;
+    }
+    // 下一個 frame：紀錄或結尾
+    frame_len = 0;
+    if (committed.records < committed.record_count)
+    {
+        phase = PHASE_RECORD_HEAD;
+        frame_need = 4;
+    }
+    else
+    {
+        phase = PHASE_TRAILER;
+        frame_need = IR_BUNDLE_TRAILER_SIZE;
+    }
+    return IR_BUNDLE_NEED_MORE;
+}
+
+#endif // PULMOTE_ENABLE_IR
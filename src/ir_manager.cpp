@@ -1,5 +1,11 @@
 // IRManager 模組 Source
+#include "board_config.h"
+#if PULMOTE_ENABLE_IR
 #include "ir_manager.h"
+#include <LittleFS.h>
+
+#define IR_LIBRARY_DIR "/ir"
+#define IR_EXPORT_CHUNK 1024 // HTTP chunk 大小
 
 IRManager::IRManager()
 {
@@ -8,11 +14,19 @@ IRManager::IRManager()
     ir_receive_pin = 0;
     ir_send_pin = 0;
     is_learning = false;
+    exporter = nullptr;
+    exportFinished = false;
+    exportFailed = false;
+    importer = nullptr;
+    importStatus = IR_BUNDLE_NEED_MORE;
+    memset(&importSaved, 0, sizeof(importSaved));
 }
 
 IRManager::~IRManager()
 {
     // 解構子
+    endExport();
+    endImport();
 }
 
 void IRManager::init(uint16_t rx_pin, uint16_t tx_pin, uint16_t status_pin)
@@ -21,6 +35,14 @@ void IRManager::init(uint16_t rx_pin, uint16_t tx_pin, uint16_t status_pin)
     ir_send_pin = tx_pin;
     dev_status_pin = status_pin;
     // 紅外線初始化流程
+    // 指令庫存放於 LittleFS，每個指令一個檔案，內容為 little-endian 的 uint16 時序陣列
+    if (!LittleFS.begin(true))
+    {
+        Serial.println("IRManager: LittleFS mount failed");
+        return;
+    }
+    if (!LittleFS.exists(IR_LIBRARY_DIR))
+        LittleFS.mkdir(IR_LIBRARY_DIR);
 }
 
 void IRManager::loop()
@@ -55,3 +77,291 @@ void IRManager::getReceivedSignal()
 {
     // 獲取接收到的訊號
 }
+
+bool IRManager::saveCode(const char *name, const uint16_t *data, uint16_t length)
+{
+    if (!irBundleValidName(name, strlen(name)) || length > IR_BUNDLE_MAX_SAMPLES)
+        return false;
+    String path = String(IR_LIBRARY_DIR "/") + name;
+    File f = LittleFS.open(path, FILE_WRITE);
+    if (!f)
+        return false;
+    // ESP32 為 little-endian，記憶體內容即為儲存格式
+    size_t bytes = (size_t)length * 2;
+    bool ok = f.write(reinterpret_cast<const uint8_t *>(data), bytes) == bytes;
+    f.close();
+    return ok;
+}
+
+uint16_t IRManager::loadCode(const char *name, uint16_t *data, uint16_t max_length)
+{
+    if (!irBundleValidName(name, strlen(name)))
+        return 0;
+    String path = String(IR_LIBRARY_DIR "/") + name;
+    File f = LittleFS.open(path, FILE_READ);
+    if (!f)
+        return 0;
+    size_t count = f.size() / 2;
+    if (count > max_length)
+        count = max_length;
+    size_t got = f.read(reinterpret_cast<uint8_t *>(data), count * 2);
+    f.close();
+    return (uint16_t)(got / 2);
+}
+
+// 可匯出的檔案回傳紀錄名稱，否則回傳 nullptr
+// 計數與實際輸出都以此判斷，標頭的紀錄數才會與輸出的紀錄一致
+static const char *exportName(File &f)
+{
+    if (f.isDirectory())
+        return nullptr;
+    const char *name = f.name();
+    const char *slash = strrchr(name, '/');
+    if (slash)
+        name = slash + 1;
+    if (!irBundleValidName(name, strlen(name)))
+        return nullptr;
+    // 以 size_t 比較，轉成 uint16_t 前先排除過大的檔案，避免截斷
+    if (f.size() / 2 > (size_t)IR_BUNDLE_MAX_SAMPLES)
+        return nullptr;
+    return name;
+}
+
+bool IRManager::beginExport()
+{
+    endExport();
+    // 先計算紀錄數量寫入標頭，只走訪目錄、不讀取內容
+    File dir = LittleFS.open(IR_LIBRARY_DIR);
+    if (!dir || !dir.isDirectory())
+        return false;
+    uint32_t count = 0;
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile())
+    {
+        if (exportName(f))
+            ++count;
+        else if (!f.isDirectory())
+            Serial.printf("IRManager: export skips '%s'\n", f.name());
+    }
+    dir.close();
+
+    exportDir = LittleFS.open(IR_LIBRARY_DIR);
+    exporter = new IRBundleWriter();
+    exporter->begin(count);
+    exportFinished = false;
+    exportFailed = false;
+    return true;
+}
+
+size_t IRManager::readExport(uint8_t *buf, size_t len)
+{
+    if (!exporter)
+        return 0;
+    size_t total = 0;
+    while (total < len)
+    {
+        if (exporter->drained())
+        {
+            if (exportFinished)
+                break;
+            // 一次只載入一筆紀錄
+            File f = exportDir.openNextFile();
+            const char *name = nullptr;
+            while (f && !(name = exportName(f)))
+                f = exportDir.openNextFile();
+            if (!f)
+            {
+                exporter->finish();
+                exportFinished = true;
+                continue;
+            }
+            uint16_t count = (uint16_t)(f.size() / 2);
+            uint8_t *samples = exporter->beginRecord(name, count);
+            size_t bytes = (size_t)count * 2;
+            if (!samples || f.read(samples, bytes) != bytes)
+            {
+                // 讀取失敗就中止，不送出結尾，匯入端不會把不完整的備份當成完成
+                Serial.printf("IRManager: export aborted, cannot read '%s'\n", name);
+                f.close();
+                endExport();
+                exportFailed = true;
+                return total;
+            }
+            f.close();
+            exporter->commitRecord();
+        }
+        total += exporter->read(buf + total, len - total);
+    }
+    if (total == 0)
+        endExport();
+    return total;
+}
+
+void IRManager::endExport()
+{
+    if (exportDir)
+        exportDir.close();
+    delete exporter;
+    exporter = nullptr;
+    exportFinished = false;
+    exportFailed = false;
+}
+
+bool IRManager::beginImport(uint32_t offset)
+{
+    endImport();
+    importer = new IRBundleReader();
+    importStatus = IR_BUNDLE_NEED_MORE;
+    memset(&importSaved, 0, sizeof(importSaved));
+    if (offset == 0)
+    {
+        preferences.begin("ir_import", false);
+        preferences.remove("state");
+        preferences.end();
+        return true;
+    }
+    // 續傳：從 Preferences 讀回檢查點，offset 必須一致
+    IRBundleCheckpoint state;
+    preferences.begin("ir_import", true);
+    size_t got = preferences.getBytes("state", &state, sizeof(state));
+    preferences.end();
+    if (got != sizeof(state) || state.offset != offset || !importer->resume(state))
+    {
+        endImport();
+        return false;
+    }
+    importSaved = state;
+    return true;
+}
+
+IRBundleStatus IRManager::writeImport(const uint8_t *data, size_t len)
+{
+    if (!importer)
+        return IR_BUNDLE_REJECTED;
+    importStatus = importer->feed(data, len, importRecord, this);
+    if (importStatus == IR_BUNDLE_DONE)
+    {
+        preferences.begin("ir_import", false);
+        preferences.remove("state");
+        preferences.end();
+        endImport();
+    }
+    else if (importStatus == IR_BUNDLE_NEED_MORE)
+    {
+        saveImportProgress(false);
+    }
+    else
+    {
+        // 失敗前已寫入的紀錄仍有效，保存後結束，GET /ir/import 回報的位置與 beginImport() 一致
+        saveImportProgress(true);
+        endImport();
+    }
+    return importStatus;
+}
+
+uint32_t IRManager::importOffset()
+{
+    // 只回報已保存的進度：匯入中的檢查點可能超前 Preferences，續傳時會被 beginImport() 拒絕
+    IRBundleCheckpoint state;
+    preferences.begin("ir_import", true);
+    size_t got = preferences.getBytes("state", &state, sizeof(state));
+    preferences.end();
+    return got == sizeof(state) ? state.offset : 0;
+}
+
+void IRManager::saveImportProgress(bool force)
+{
+    // 每個 HTTP 片段約 1.4KB，逐段寫入 NVS 太頻繁；改為每 IR_IMPORT_SAVE_RECORDS 筆或 IR_IMPORT_SAVE_BYTES 保存一次
+    IRBundleCheckpoint state = importer->checkpoint();
+    if (state.records == importSaved.records)
+        return;
+    if (!force && state.records - importSaved.records < IR_IMPORT_SAVE_RECORDS &&
+        state.offset - importSaved.offset < IR_IMPORT_SAVE_BYTES)
+        return;
+    preferences.begin("ir_import", false);
+    preferences.putBytes("state", &state, sizeof(state));
+    preferences.end();
+    importSaved = state;
+}
+
+void IRManager::endImport()
+{
+    delete importer;
+    importer = nullptr;
+}
+
+bool IRManager::importRecord(const IRBundleRecord &record, void *context)
+{
+    (void)context;
+    char path[sizeof(IR_LIBRARY_DIR) + 1 + IR_BUNDLE_MAX_NAME + 1];
+    snprintf(path, sizeof(path), IR_LIBRARY_DIR "/%.*s", (int)record.name_len, record.name);
+    File f = LittleFS.open(path, FILE_WRITE);
+    if (!f)
+        return false;
+    size_t bytes = (size_t)record.sample_count * 2;
+    bool ok = f.write(record.samples, bytes) == bytes;
+    f.close();
+    return ok;
+}
+
+void IRManager::registerRoutes(WebServer &server)
+{
+    // 匯出：chunked transfer，邊讀檔邊送出
+    server.on("/ir/export", HTTP_GET, [this, &server]()
+              {
+        if (!beginExport()) {
+            server.send(500, "text/plain", "library unavailable");
+            return;
+        }
+        server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+        server.send(200, "application/octet-stream", "");
+        uint8_t buf[IR_EXPORT_CHUNK];
+        size_t n;
+        while ((n = readExport(buf, sizeof(buf))) > 0)
+            server.sendContent(reinterpret_cast<const char *>(buf), n);
+        if (exportFailed) {
+            server.client().stop(); // 不送出結束的 chunk，用戶端會視為傳輸失敗
+            return;
+        }
+        server.sendContent(""); });
+
+    // 查詢續傳位置
+    server.on("/ir/import", HTTP_GET, [this, &server]()
+              { server.send(200, "application/json", String("{\"offset\":") + String(importOffset()) + "}"); });
+
+    // 匯入：POST application/octet-stream，?offset=N 從第 N 個位元組續傳
+    server.on(
+        "/ir/import", HTTP_POST, [this, &server]()
+        {
+        if (importer)
+        {
+            saveImportProgress(true); // 本次請求的資料已用完，保存後由下一個請求續傳
+            endImport();
+        }
+        if (importStatus == IR_BUNDLE_DONE)
+            server.send(200, "text/plain", "imported");
+        else if (importStatus == IR_BUNDLE_NEED_MORE)
+            server.send(202, "application/json", String("{\"offset\":") + String(importOffset()) + "}");
+        else
+            server.send(400, "text/plain", String("import failed: ") + String((int)importStatus)); },
+        [this, &server]()
+        {
+            HTTPRaw &raw = server.raw();
+            if (raw.status == RAW_START)
+            {
+                uint32_t offset = server.hasArg("offset") ? (uint32_t)server.arg("offset").toInt() : 0;
+                if (!beginImport(offset))
+                    importStatus = IR_BUNDLE_REJECTED; // 續傳位置與保存的進度不符
+            }
+            else if (raw.status == RAW_WRITE && importer)
+            {
+                writeImport(raw.buf, raw.currentSize);
+            }
+            else if (raw.status == RAW_ABORTED && importer)
+            {
+                saveImportProgress(true); // 可用 GET /ir/import 查詢後續傳
+                endImport();
+            }
+        });
+}
+
+#endif // PULMOTE_ENABLE_IR
@@ -1,10 +1,42 @@
 // Pulmote ESP32 Main Program Skeleton
-#include "ble_manager.h"
+#include "board_config.h"
+#include "module_registry.h"
+#include "boot_orchestrator.h"
 #include "wifi_manager.h"
+#if PULMOTE_ENABLE_BLE
+#include "ble_manager.h"
+#endif
+#if PULMOTE_ENABLE_MQTT
 #include "mqtt_manager.h"
+#endif
+#if PULMOTE_ENABLE_IR
 #include "ir_manager.h"
+#endif
+#if PULMOTE_ENABLE_OTA
+#include "ota_manager.h"
+#endif
 #include <Preferences.h>
 
+#if PULMOTE_ENABLE_MQTT
+const char *MQTT_BROKER = ""; // 填入 Broker 位址（例如 "192.168.1.100"）後才會連線
+const uint16_t MQTT_PORT = 1883;
+const char *MQTT_CLIENT_ID_PREFIX = "pulmote-"; // 後接 MAC，每台裝置各自的 session
+
+const char *mqttClientId()
+{
+    static char id[24];
+    uint64_t mac = ESP.getEfuseMac(); // 第一個位元組在最低位
+    snprintf(id, sizeof(id), "%s%02x%02x%02x%02x%02x%02x", MQTT_CLIENT_ID_PREFIX,
+             (unsigned)(mac & 0xFF), (unsigned)((mac >> 8) & 0xFF), (unsigned)((mac >> 16) & 0xFF),
+             (unsigned)((mac >> 24) & 0xFF), (unsigned)((mac >> 32) & 0xFF), (unsigned)((mac >> 40) & 0xFF));
+    return id;
+}
+#endif
+#if PULMOTE_ENABLE_MQTT && PULMOTE_ENABLE_OTA
+const char *OTA_PATCH_TOPIC = "pulmote/ota/patch";   // 分段格式見 OTAManager::writeFragment()
+const char *OTA_STATUS_TOPIC = "pulmote/ota/status"; // 更新結果
+#endif
+
 void clearWifiConfig() // 清除 Preferences 中的 WiFi SSID 與密碼
 {
     Preferences preferences;
@@ -15,30 +47,169 @@ void clearWifiConfig() // 清除 Preferences 中的 WiFi SSID 與密碼
 }
 
 WiFiManager wifiManager;
+#if PULMOTE_ENABLE_BLE
 BLEManager bleManager;
+#endif
+#if PULMOTE_ENABLE_MQTT
 MQTTManager mqttManager;
+#endif
+#if PULMOTE_ENABLE_IR
 IRManager irManager;
-uint16_t ir_rx_pin = 15; // Example IR receive pin
-uint16_t ir_tx_pin = 4;  // Example IR send pin
-uint16_t dev_status_pin = 2;
+#endif
+#if PULMOTE_ENABLE_OTA
+OTAManager otaManager;
+
+bool otaHealthCheck() // 更新後的新映像連上 WiFi 才視為正常
+{
+    return WiFi.isConnected();
+}
+#endif
+BootOrchestrator bootOrchestrator;
+
+#if PULMOTE_ENABLE_MQTT && PULMOTE_ENABLE_OTA
+void onMqttBinary(const char *topic, const uint8_t *payload, unsigned int length) // 透過 MQTT 分段接收 patch
+{
+    if (strcmp(topic, OTA_PATCH_TOPIC) != 0)
+        return;
+    if (!otaManager.writeFragment(payload, length))
+        mqttManager.publish(OTA_STATUS_TOPIC, (String("update failed: ") + otaManager.lastError()).c_str(), false, 1);
+    else if (length == 4) // 結束片段：已切換開機分區，稍後重新開機
+        mqttManager.publish(OTA_STATUS_TOPIC, "update applied, restarting", false, 1);
+}
+#endif
+
+void registerWebRoutes(WebServer &server) // 由 WiFiManager 在啟動設定頁或連線後的服務 Web Server 時呼叫
+{
+#if PULMOTE_ENABLE_IR
+    irManager.registerRoutes(server);
+#endif
+#if PULMOTE_ENABLE_OTA
+    otaManager.registerRoutes(server);
+#endif
+}
+
+// 模組註冊：腳位取自 board::Active，停用的模組以 DisabledModule 代替
+// deps() 決定開機順序，沒有相依關係的模組會同時初始化
+struct WiFiModule
+{
+    static const bool enabled = true;
+    static const bool lazy = false;
+    static const bool background = false;
+    static const char *name() { return "wifi"; }
+    static const char *deps() { return ""; }
+    static void init()
+    {
+        wifiManager.setRouteHook(registerWebRoutes);
+        wifiManager.init(board::Active::kStatusPin);
+    }
+    static void loop() { wifiManager.loop(); }
+};
+
+// 等待 WiFi 連上並取得 IP，時間軸因此包含無線連線時間
+// background：setup() 不等它完成，IR 與 Web Server 照常運作，完成時間由 loop() 的 poll() 記錄
+struct WiFiAssocModule
+{
+    static const bool enabled = true;
+    static const bool lazy = false;
+    static const bool background = true;
+    static const char *name() { return "assoc"; }
+    static const char *deps() { return "wifi"; }
+    static void init() { wifiManager.waitForConnection(WIFI_ASSOC_TIMEOUT_MS); }
+    static void loop() {}
+};
+
+#if PULMOTE_ENABLE_BLE
+struct BLEModule
+{
+    static const bool enabled = true;
+    static const bool lazy = true; // 只在需要時啟動，見 loop()
+    static const bool background = false;
+    static const char *name() { return "ble"; }
+    static const char *deps() { return "wifi"; }
+    static void init() { bleManager.init(); }
+    static void loop() { bleManager.loop(); }
+};
+#else
+struct BLEModule : DisabledModule
+{
+};
+#endif
+
+#if PULMOTE_ENABLE_MQTT
+struct MQTTModule
+{
+    static const bool enabled = true;
+    static const bool lazy = false;
+    static const bool background = false;
+    static const char *name() { return "mqtt"; }
+    static const char *deps() { return "assoc"; } // 相依 background 模組，同樣在背景初始化
+    static void init()
+    {
+        mqttManager.init();
+        mqttManager.setServer(MQTT_BROKER, MQTT_PORT, mqttClientId()); // 由 loop() 連線，Broker 無回應時不延遲開機
+#if PULMOTE_ENABLE_OTA
+        mqttManager.setBinaryCallback(onMqttBinary);
+        mqttManager.subscribe(OTA_PATCH_TOPIC, 1);
+#endif
+    }
+    static void loop() { mqttManager.loop(); }
+};
+#else
+struct MQTTModule : DisabledModule
+{
+};
+#endif
+
+#if PULMOTE_ENABLE_IR
+struct IRModule
+{
+    static const bool enabled = true;
+    static const bool lazy = false;
+    static const bool background = false;
+    static const char *name() { return "ir"; }
+    static const char *deps() { return ""; }
+    static void init() { irManager.init(board::Active::kIrRxPin, board::Active::kIrTxPin, board::Active::kStatusPin); }
+    static void loop() { irManager.loop(); }
+};
+#else
+struct IRModule : DisabledModule
+{
+};
+#endif
+
+typedef ModuleList<WiFiModule, WiFiAssocModule, BLEModule, MQTTModule, IRModule> Modules;
 
 void setup()
 {
     // Do not clear WiFi credentials on every boot
     // clearWifiConfig(); // 這行會在每次啟動時清除 WiFi 設定，請根據需要決定是否保留
     Serial.begin(115200);
-    delay(50);
     Serial.println("Main: startup - Serial initialized");
-    pinMode(dev_status_pin, OUTPUT); // 初始化 LED 腳位
-    wifiManager.init(dev_status_pin);
-    bleManager.init();
-    mqttManager.init();
-    irManager.init(ir_rx_pin, ir_tx_pin, dev_status_pin);
+    Serial.printf("Main: board=%s modules=%u\n", board::Active::name(), (unsigned)Modules::enabledCount);
+    pinMode(board::Active::kStatusPin, OUTPUT); // 初始化 LED 腳位
+#if PULMOTE_ENABLE_OTA
+    // 先於其他模組執行：新映像若在初始化時當機，開機次數仍會被記錄以便回滾
+    otaManager.setHealthCheck(otaHealthCheck);
+    otaManager.init();
+#endif
+    Modules::registerAll(bootOrchestrator);
+    bootOrchestrator.run(); // WiFi 與 IR 硬體 / LittleFS 同時初始化後返回，assoc 與 MQTT 在背景繼續
+    bootOrchestrator.printTimeline();
     // ...其他初始化流程...
 }
 
 void loop()
 {
-    wifiManager.loop();
+#if PULMOTE_ENABLE_BLE
+    // BLE 用於設定 WiFi，只在確實需要設定時才啟動：沒有儲存的帳密，或超過時限仍連不上
+    // 不以 AP 模式判斷，連線過程中的 WL_DISCONNECTED 也會開啟 AP
+    if (wifiManager.needsProvisioning())
+        bootOrchestrator.ensure(BLEModule::name());
+#endif
+    bootOrchestrator.poll(); // 背景模組完成後記錄時間軸並啟動 MQTT
+    Modules::loopAll(bootOrchestrator);
+#if PULMOTE_ENABLE_OTA
+    otaManager.loop();
+#endif
     // ...其他主程式邏輯...
 }
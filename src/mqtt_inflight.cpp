@@ -0,0 +1,243 @@
+// MQTT QoS 1 發送視窗 Source
+#include "board_config.h"
+#if PULMOTE_ENABLE_MQTT
+#include "mqtt_inflight.h"
+
+MQTTInflightWindow::MQTTInflightWindow()
+{
+    for (size_t i = 0; i < MQTT_RETRY_STORE_SIZE; ++i)
+    {
+        slots[i].packet_id = 0;
+        slots[i].retain = false;
+        slots[i].dup = false;
+        states[i] = SLOT_FREE;
+    }
+    head = 0;
+    count = 0;
+    unacked = 0;
+    next_packet_id = 1;
+    window = 0;
+    setWindow(MQTT_INFLIGHT_WINDOW);
+}
+
+void MQTTInflightWindow::setWindow(uint8_t value)
+{
+    if (value < 1)
+        value = 1;
+    if (value > MQTT_RETRY_STORE_SIZE)
+        value = MQTT_RETRY_STORE_SIZE;
+    window = value;
+}
+
+uint8_t MQTTInflightWindow::getWindow() const
+{
+    return window;
+}
+
+size_t MQTTInflightWindow::slotAt(size_t index) const
+{
+    return (head + index) % MQTT_RETRY_STORE_SIZE;
+}
+
+bool MQTTInflightWindow::enqueue(const char *topic, const char *payload, bool retain)
+{
+    if (count >= MQTT_RETRY_STORE_SIZE)
+        return false; // 暫存區已滿，由呼叫端決定是否丟棄
+    size_t slot = slotAt(count);
+    slots[slot].topic = topic;
+    slots[slot].payload = payload ? payload : "";
+    slots[slot].packet_id = 0;
+    slots[slot].retain = retain;
+    slots[slot].dup = false;
+    states[slot] = SLOT_QUEUED;
+    ++count;
+    return true;
+}
+
+MQTTOutboundMessage *MQTTInflightWindow::nextToSend()
+{
+    // 先重送斷線前未確認的訊息，維持原本的發送順序
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t slot = slotAt(i);
+        if (states[slot] == SLOT_RESEND)
+        {
+            states[slot] = SLOT_INFLIGHT;
+            slots[slot].dup = true;
+            return &slots[slot];
+        }
+    }
+    if (unacked >= window)
+        return nullptr; // 視窗已滿，等待 PUBACK
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t slot = slotAt(i);
+        if (states[slot] == SLOT_QUEUED)
+        {
+            states[slot] = SLOT_INFLIGHT;
+            slots[slot].packet_id = allocatePacketId();
+            ++unacked;
+            return &slots[slot];
+        }
+    }
+    return nullptr;
+}
+
+bool MQTTInflightWindow::acknowledge(uint16_t packet_id)
+{
+    if (packet_id == 0)
+        return false;
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t slot = slotAt(i);
+        if ((states[slot] == SLOT_INFLIGHT || states[slot] == SLOT_RESEND) && slots[slot].packet_id == packet_id)
+        {
+            states[slot] = SLOT_ACKED;
+            --unacked;
+            releaseAcked();
+            return true;
+        }
+    }
+    return false; // 未知或重複的 PUBACK
+}
+
+void MQTTInflightWindow::requeueInflight()
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t slot = slotAt(i);
+        if (states[slot] == SLOT_INFLIGHT)
+            states[slot] = SLOT_RESEND;
+    }
+}
+
+void MQTTInflightWindow::setNextPacketId(uint16_t id)
+{
+    next_packet_id = id ? id : 1;
+}
+
+size_t MQTTInflightWindow::pending() const
+{
+    return count;
+}
+
+size_t MQTTInflightWindow::inflight() const
+{
+    return unacked;
+}
+
+uint16_t MQTTInflightWindow::allocatePacketId()
+{
+    // Packet ID 範圍為 1 ~ 65535，跳過仍在使用中的 ID
+    for (;;)
+    {
+        uint16_t id = next_packet_id++;
+        if (next_packet_id == 0)
+            next_packet_id = 1;
+        bool in_use = false;
+        for (size_t i = 0; i < count && !in_use; ++i)
+        {
+            size_t slot = slotAt(i);
+            in_use = states[slot] != SLOT_QUEUED && slots[slot].packet_id == id;
+        }
+        if (!in_use)
+            return id;
+    }
+}
+
+void MQTTInflightWindow::releaseAcked()
+{
+    // PUBACK 可能不按順序到達，只從佇列前端移除連續已確認的訊息
+    while (count > 0 && states[head] == SLOT_ACKED)
+    {
+        states[head] = SLOT_FREE;
+        slots[head].topic.clear();
+        slots[head].payload.clear();
+        slots[head].packet_id = 0;
+        head = (head + 1) % MQTT_RETRY_STORE_SIZE;
+        --count;
+    }
+}
+
+void mqttEncodePublish(const MQTTOutboundMessage &msg, std::string &out)
+{
+    // PUBLISH 固定標頭：type=3，QoS=1，依需要加上 DUP / RETAIN
+    uint8_t header = 0x32;
+    if (msg.dup)
+        header |= 0x08;
+    if (msg.retain)
+        header |= 0x01;
+    size_t topic_len = msg.topic.length();
+    uint32_t remaining = (uint32_t)(2 + topic_len + 2 + msg.payload.length());
+
+    out.clear();
+    out.push_back((char)header);
+    do
+    {
+        uint8_t digit = remaining % 128;
+        remaining /= 128;
+        if (remaining > 0)
+            digit |= 0x80;
+        out.push_back((char)digit);
+    } while (remaining > 0);
+    out.push_back((char)(topic_len >> 8));
+    out.push_back((char)(topic_len & 0xFF));
+    out.append(msg.topic);
+    out.push_back((char)(msg.packet_id >> 8));
+    out.push_back((char)(msg.packet_id & 0xFF));
+    out.append(msg.payload);
+}
+
+MQTTPubackScanner::MQTTPubackScanner()
+{
+    reset();
+}
+
+void MQTTPubackScanner::reset()
+{
+    state = SCAN_HEADER;
+    packet_type = 0;
+    remaining = 0;
+    length_multiplier = 1;
+    body_index = 0;
+    ack_id = 0;
+}
+
+bool MQTTPubackScanner::feed(uint8_t byte, uint16_t &packet_id)
+{
+    switch (state)
+    {
+    case SCAN_HEADER:
+        packet_type = byte >> 4;
+        remaining = 0;
+        length_multiplier = 1;
+        state = SCAN_LENGTH;
+        return false;
+    case SCAN_LENGTH:
+        // Remaining Length 為可變長度編碼，每個位元組 7 bits
+        remaining += (uint32_t)(byte & 0x7F) * length_multiplier;
+        length_multiplier *= 128;
+        if (byte & 0x80)
+            return false;
+        body_index = 0;
+        ack_id = 0;
+        state = remaining > 0 ? SCAN_BODY : SCAN_HEADER;
+        return false;
+    case SCAN_BODY:
+        if (packet_type == 4 && body_index < 2) // PUBACK: Packet ID 位於 variable header 前兩個位元組
+            ack_id = (uint16_t)((ack_id << 8) | byte);
+        ++body_index;
+        if (body_index < remaining)
+            return false;
+        state = SCAN_HEADER;
+        if (packet_type == 4 && remaining >= 2)
+        {
+            packet_id = ack_id;
+            return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+#endif // PULMOTE_ENABLE_MQTT
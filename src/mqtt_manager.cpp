@@ -1,15 +1,256 @@
+// MQTTManager 模組 Source
+#include "board_config.h"
+#if PULMOTE_ENABLE_MQTT
 #include "mqtt_manager.h"
+#include <WiFi.h>
+
+MQTTAckTap::MQTTAckTap(WiFiClient &inner, MQTTInflightWindow &window)
+    : inner(inner), window(window)
+{
+}
+
+int MQTTAckTap::connect(IPAddress ip, uint16_t port)
+{
+    scanner.reset(); // 新連線從封包邊界開始解析
+    int result = inner.connect(ip, port, MQTT_CONNECT_TIMEOUT_MS);
+    if (result)
+        inner.setNoDelay(true); // 管線送出的 PUBLISH 不等前一段被確認
+    return result;
+}
+
+int MQTTAckTap::connect(const char *host, uint16_t port)
+{
+    scanner.reset();
+    int result = inner.connect(host, port, MQTT_CONNECT_TIMEOUT_MS);
+    if (result)
+        inner.setNoDelay(true);
+    return result;
+}
+
+size_t MQTTAckTap::write(uint8_t b)
+{
+    return inner.write(b);
+}
+
+size_t MQTTAckTap::write(const uint8_t *buf, size_t size)
+{
+    return inner.write(buf, size);
+}
+
+int MQTTAckTap::available()
+{
+    return inner.available();
+}
+
+int MQTTAckTap::read()
+{
+    int b = inner.read();
+    if (b >= 0)
+        scan((uint8_t)b);
+    return b;
+}
+
+int MQTTAckTap::read(uint8_t *buf, size_t size)
+{
+    int n = inner.read(buf, size);
+    for (int i = 0; i < n; ++i)
+        scan(buf[i]);
+    return n;
+}
+
+int MQTTAckTap::peek()
+{
+    return inner.peek();
+}
+
+void MQTTAckTap::flush()
+{
+    inner.flush();
+}
+
+void MQTTAckTap::stop()
+{
+    inner.stop();
+}
+
+uint8_t MQTTAckTap::connected()
+{
+    return inner.connected();
+}
+
+MQTTAckTap::operator bool()
+{
+    return (bool)inner;
+}
+
+void MQTTAckTap::scan(uint8_t b)
+{
+    uint16_t packet_id;
+    if (scanner.feed(b, packet_id))
+        window.acknowledge(packet_id);
+}
+
 MQTTManager::MQTTManager()
+    : ackTap(netClient, inflight), client(ackTap)
 {
     // 建構子初始化
+    broker_address = nullptr;
+    broker_port = 1883;
+    client_id = nullptr;
+    is_connected = false;
+    message_callback = nullptr;
+    binary_callback = nullptr;
+    subscription_count = 0;
+    lastReconnectMillis = 0;
 }
 
 void MQTTManager::init()
 {
     // MQTT 初始化流程
+    client.setBufferSize(MQTT_BUFFER_SIZE);
+    client.setSocketTimeout((MQTT_CONNECT_TIMEOUT_MS + 999) / 1000); // 等待 CONNACK 的時間（秒）
+    client.setCallback([this](char *topic, uint8_t *payload, unsigned int length)
+                       {
+        if (binary_callback) binary_callback(topic, payload, length);
+        if (!message_callback) return;
+        std::string text(reinterpret_cast<const char *>(payload), length);
+        message_callback(topic, text.c_str()); });
+}
+
+bool MQTTManager::connect(const char *broker, uint16_t port, const char *id)
+{
+    setServer(broker, port, id);
+    return reconnect();
+}
+
+void MQTTManager::setServer(const char *broker, uint16_t port, const char *id)
+{
+    broker_address = broker && *broker ? broker : nullptr; // 尚未設定 Broker 時 loop() 不連線
+    broker_port = port;
+    client_id = id;
+    client.setServer(broker_address, broker_port);
+}
+
+bool MQTTManager::reconnect()
+{
+    lastReconnectMillis = millis();
+    if (!broker_address)
+        return false;
+    // cleanSession = false：Broker 保留 session，重連後以 DUP 重送的訊息才能正確去重
+    is_connected = client.connect(client_id, nullptr, nullptr, nullptr, 0, false, nullptr, false);
+    if (!is_connected)
+    {
+        Serial.printf("MQTTManager: connect to %s:%u failed, state=%d\n", broker_address, (unsigned)broker_port, client.state());
+        return false;
+    }
+    Serial.printf("MQTTManager: connected to %s:%u\n", broker_address, (unsigned)broker_port);
+    for (size_t i = 0; i < subscription_count; ++i)
+        client.subscribe(subscriptions[i].c_str(), subscription_qos[i]);
+    inflight.requeueInflight(); // 斷線前未確認的訊息重新送出
+    flushInflight();
+    return true;
+}
+
+bool MQTTManager::subscribe(const char *topic, uint8_t qos)
+{
+    size_t i = 0;
+    while (i < subscription_count && subscriptions[i] != topic)
+        ++i;
+    if (i == subscription_count)
+    {
+        if (subscription_count >= MQTT_MAX_SUBSCRIPTIONS)
+            return false;
+        subscriptions[subscription_count++] = topic;
+    }
+    subscription_qos[i] = qos;
+    // 尚未連線時只記錄，連線後由 reconnect() 訂閱
+    return !is_connected || client.subscribe(topic, qos);
+}
+
+bool MQTTManager::publish(const char *topic, const char *payload, bool retain, uint8_t qos)
+{
+    if (qos == 0)
+        return client.publish(topic, payload, retain);
+    if (!inflight.enqueue(topic, payload, retain))
+    {
+        Serial.println("MQTTManager: QoS 1 retry store full, message dropped");
+        return false;
+    }
+    if (is_connected)
+        flushInflight(); // 視窗未滿就立即送出，不等待前一筆 PUBACK
+    return true;
+}
+
+void MQTTManager::setInflightWindow(uint8_t window)
+{
+    inflight.setWindow(window);
+}
+
+size_t MQTTManager::pendingCount()
+{
+    return inflight.pending();
+}
+
+bool MQTTManager::isConnected()
+{
+    return is_connected;
+}
+
+void MQTTManager::setCallback(mqtt_callback_t callback)
+{
+    message_callback = callback;
+}
+
+void MQTTManager::setBinaryCallback(mqtt_binary_callback_t callback)
+{
+    binary_callback = callback;
+}
+
+void MQTTManager::flushInflight()
+{
+    MQTTOutboundMessage *msg;
+    while ((msg = inflight.nextToSend()) != nullptr)
+    {
+        if (!writePublish(*msg))
+        {
+            // 寫入失敗視為斷線，訊息保留在暫存區，重連後重送
+            client.disconnect();
+            is_connected = false;
+            return;
+        }
+    }
+}
+
+bool MQTTManager::writePublish(const MQTTOutboundMessage &msg)
+{
+    mqttEncodePublish(msg, txBuffer);
+
+    // 整個封包一次寫出，避免拆成多個 TCP 區段
+    size_t written = client.write(reinterpret_cast<const uint8_t *>(txBuffer.data()), txBuffer.length());
+    return written == txBuffer.length();
 }
 
 void MQTTManager::loop()
 {
     // MQTT 狀態循環處理
+    if (!broker_address)
+        return;
+    if (!client.connected())
+    {
+        is_connected = false;
+        // 每 5 秒嘗試重新連線一次，避免阻塞主循環
+        if (WiFi.isConnected() && (unsigned long)(millis() - lastReconnectMillis) >= 5000)
+            reconnect();
+        return;
+    }
+    client.loop(); // 讀取封包，PUBACK 由 MQTTAckTap 處理
+    flushInflight();
 }
+
+void MQTTManager::disconnect()
+{
+    client.disconnect();
+    is_connected = false;
+}
+
+#endif // PULMOTE_ENABLE_MQTT
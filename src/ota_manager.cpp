@@ -0,0 +1,506 @@
+// OTAManager 模組 Source
+#include "board_config.h"
+#if PULMOTE_ENABLE_OTA
+#include "ota_manager.h"
+#include "delta_patch.h"
+#include "ota_signing_key.h"
+#include <new>
+#include <HTTPClient.h>
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp32/rom/miniz.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/ecdsa.h"
+
+#define OTA_WRITE_BUFFER 4096 // 累積後再寫入 flash，減少 esp_ota_write 次數
+#define OTA_SIGNED_HEADER_SIZE (DELTA_PATCH_HEADER_SIZE + DELTA_PATCH_SIGNATURE_SIZE)
+
+struct OTAManager::Session
+{
+    uint8_t header_buf[OTA_SIGNED_HEADER_SIZE]; // 標頭與簽章
+    size_t header_len;
+    DeltaPatchHeader header;
+    tinfl_decompressor inflator;
+    uint8_t dict[TINFL_LZ_DICT_SIZE]; // deflate 需要 32KB 的滑動視窗
+    size_t dict_ofs;
+    DeltaPatchApplier applier;
+    mbedtls_sha256_context sha; // 新映像的 SHA-256
+    const esp_partition_t *running;
+    const esp_partition_t *target;
+    esp_ota_handle_t handle;
+    bool ota_started;
+    uint8_t out_buf[OTA_WRITE_BUFFER];
+    size_t out_len;
+    uint32_t received; // 已收到的 patch 位元組數（含標頭）
+};
+
+static bool signingKeyConfigured()
+{
+    return OTA_SIGNING_PUBLIC_KEY[0] == 0x04;
+}
+
+// ECDSA P-256 驗證標頭簽章；標頭含新映像的 SHA-256，end() 比對後即涵蓋整個映像
+static bool verifyHeaderSignature(const uint8_t *header, const uint8_t *signature)
+{
+    uint8_t digest[32];
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    mbedtls_sha256_update(&sha, header, DELTA_PATCH_HEADER_SIZE);
+    mbedtls_sha256_finish(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    mbedtls_ecp_group group;
+    mbedtls_ecp_point key;
+    mbedtls_mpi r;
+    mbedtls_mpi s;
+    mbedtls_ecp_group_init(&group);
+    mbedtls_ecp_point_init(&key);
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+    bool ok = mbedtls_ecp_group_load(&group, MBEDTLS_ECP_DP_SECP256R1) == 0 &&
+              mbedtls_ecp_point_read_binary(&group, &key, OTA_SIGNING_PUBLIC_KEY, sizeof(OTA_SIGNING_PUBLIC_KEY)) == 0 &&
+              mbedtls_mpi_read_binary(&r, signature, 32) == 0 &&
+              mbedtls_mpi_read_binary(&s, signature + 32, 32) == 0 &&
+              mbedtls_ecdsa_verify(&group, digest, sizeof(digest), &key, &r, &s) == 0;
+    mbedtls_mpi_free(&s);
+    mbedtls_mpi_free(&r);
+    mbedtls_ecp_point_free(&key);
+    mbedtls_ecp_group_free(&group);
+    return ok;
+}
+
+// Arduino core 在 CONFIG_APP_ROLLBACK_ENABLE 時預設開機即確認映像，改由健康檢查決定
+extern "C" bool verifyRollbackLater()
+{
+    return true;
+}
+
+OTAManager::OTAManager()
+{
+    // 建構子初始化
+    session = nullptr;
+    healthCheck = nullptr;
+    pendingVerify = false;
+    restartAt = 0;
+    fragmentsDiscarded = false;
+    errorMessage = "";
+}
+
+OTAManager::~OTAManager()
+{
+    abort();
+}
+
+void OTAManager::init()
+{
+    if (!signingKeyConfigured())
+        Serial.println("OTAManager: no signing key in ota_signing_key.h, updates will be rejected");
+    // 上次更新後尚未通過健康檢查：累計開機次數，超過上限就回滾
+    preferences.begin("ota", false);
+    pendingVerify = preferences.getBool("pending", false);
+    if (pendingVerify)
+    {
+        String target = preferences.getString("target", "");
+        const esp_partition_t *running = esp_ota_get_running_partition();
+        if (target != running->label)
+        {
+            // bootloader 已自行切回舊映像
+            Serial.println("OTAManager: update did not boot, already running previous image");
+            preferences.remove("pending");
+            preferences.remove("boots");
+            pendingVerify = false;
+        }
+        else
+        {
+            uint8_t boots = preferences.getUChar("boots", 0) + 1;
+            preferences.putUChar("boots", boots);
+            Serial.printf("OTAManager: new image pending verification (boot %u/%u)\n", (unsigned)boots, (unsigned)OTA_MAX_BOOT_ATTEMPTS);
+            if (boots > OTA_MAX_BOOT_ATTEMPTS)
+            {
+                preferences.end();
+                rollback("too many boots without passing health check");
+                return;
+            }
+        }
+    }
+    preferences.end();
+}
+
+void OTAManager::loop()
+{
+    if (restartAt && (long)(millis() - restartAt) >= 0)
+    {
+        Serial.println("OTAManager: restarting into new image");
+        ESP.restart();
+    }
+    if (!pendingVerify)
+        return;
+    if (healthCheck && healthCheck())
+        markHealthy();
+    else if (millis() > OTA_HEALTH_TIMEOUT_MS)
+        rollback("health check timeout");
+}
+
+void OTAManager::setHealthCheck(ota_health_check_t check)
+{
+    healthCheck = check;
+}
+
+const char *OTAManager::lastError()
+{
+    return errorMessage;
+}
+
+bool OTAManager::fail(const char *message)
+{
+    Serial.printf("OTAManager: %s\n", message);
+    errorMessage = message;
+    abort();
+    return false;
+}
+
+bool OTAManager::begin()
+{
+    if (restartAt)
+        return fail("update already applied, restarting"); // 目標分區已是新的開機分區，不可再覆寫
+    abort();
+    session = new (std::nothrow) Session();
+    if (!session)
+        return fail("not enough memory for update session");
+    session->header_len = 0;
+    session->dict_ofs = 0;
+    session->ota_started = false;
+    session->out_len = 0;
+    session->received = 0;
+    session->running = esp_ota_get_running_partition();
+    session->target = esp_ota_get_next_update_partition(NULL);
+    if (!session->target)
+        return fail("no OTA partition in partition table");
+    errorMessage = "";
+    return true;
+}
+
+bool OTAManager::startPatch()
+{
+    Session &s = *session;
+    if (!deltaPatchParseHeader(s.header_buf, s.header))
+        return fail("not a delta patch");
+    // 標頭中的 SHA-256 只能偵測損毀，來源以簽章確認
+    if (!signingKeyConfigured())
+        return fail("no signing key configured");
+    if (!(s.header.flags & DELTA_FLAG_SIGNED))
+        return fail("patch is not signed");
+    if (!verifyHeaderSignature(s.header_buf, s.header_buf + DELTA_PATCH_HEADER_SIZE))
+        return fail("bad patch signature");
+    if (s.header.old_size > s.running->size || s.header.new_size > s.target->size)
+        return fail("image size exceeds partition");
+
+    // 確認 patch 是針對目前執行的映像產生的
+    mbedtls_sha256_init(&s.sha);
+    mbedtls_sha256_starts(&s.sha, 0);
+    for (uint32_t offset = 0; offset < s.header.old_size; offset += OTA_WRITE_BUFFER)
+    {
+        size_t n = s.header.old_size - offset;
+        if (n > OTA_WRITE_BUFFER)
+            n = OTA_WRITE_BUFFER;
+        if (esp_partition_read(s.running, offset, s.out_buf, n) != ESP_OK)
+            return fail("failed to read running image");
+        mbedtls_sha256_update(&s.sha, s.out_buf, n);
+    }
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&s.sha, digest);
+    mbedtls_sha256_free(&s.sha);
+    if (memcmp(digest, s.header.old_sha256, sizeof(digest)) != 0)
+        return fail("patch does not match running image");
+
+    if (esp_ota_begin(s.target, s.header.new_size, &s.handle) != ESP_OK)
+        return fail("esp_ota_begin failed");
+    s.ota_started = true;
+    mbedtls_sha256_init(&s.sha);
+    mbedtls_sha256_starts(&s.sha, 0);
+    tinfl_init(&s.inflator);
+    s.applier.begin(s.header.old_size, s.header.new_size, readOld, writeNew, this);
+    Serial.printf("OTAManager: applying patch %s -> %s (%u bytes)\n", s.running->label, s.target->label, (unsigned)s.header.new_size);
+    return true;
+}
+
+bool OTAManager::write(const uint8_t *data, size_t len)
+{
+    if (!session)
+        return false;
+    Session &s = *session;
+    s.received += len;
+    if (s.header_len < OTA_SIGNED_HEADER_SIZE) // 只接受已簽章的 patch，指令流從簽章之後開始
+    {
+        size_t n = OTA_SIGNED_HEADER_SIZE - s.header_len;
+        if (n > len)
+            n = len;
+        memcpy(s.header_buf + s.header_len, data, n);
+        s.header_len += n;
+        data += n;
+        len -= n;
+        if (s.header_len < OTA_SIGNED_HEADER_SIZE)
+            return true;
+        if (!startPatch())
+            return false;
+    }
+    return feedPatch(data, len);
+}
+
+bool OTAManager::feedPatch(const uint8_t *data, size_t len)
+{
+    Session &s = *session;
+    if (!(s.header.flags & DELTA_FLAG_DEFLATE))
+    {
+        DeltaPatchStatus status = len ? s.applier.feed(data, len) : s.applier.status();
+        return status <= DELTA_DONE || fail("invalid patch data");
+    }
+    // 解壓輸出直接寫入環狀字典，每段輸出立即交給 applier
+    while (s.applier.status() == DELTA_NEED_MORE)
+    {
+        size_t in_bytes = len;
+        size_t out_bytes = TINFL_LZ_DICT_SIZE - s.dict_ofs;
+        tinfl_status status = tinfl_decompress(&s.inflator, data, &in_bytes, s.dict, s.dict + s.dict_ofs, &out_bytes,
+                                               TINFL_FLAG_HAS_MORE_INPUT);
+        data += in_bytes;
+        len -= in_bytes;
+        if (out_bytes > 0 && s.applier.feed(s.dict + s.dict_ofs, out_bytes) > DELTA_DONE)
+            return fail("invalid patch data");
+        s.dict_ofs = (s.dict_ofs + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+        if (status < TINFL_STATUS_DONE)
+            return fail("corrupt compressed stream");
+        if (status == TINFL_STATUS_DONE || (status == TINFL_STATUS_NEEDS_MORE_INPUT && len == 0))
+            break;
+    }
+    return true;
+}
+
+bool OTAManager::end()
+{
+    if (!session || !session->ota_started)
+        return fail("no update in progress");
+    Session &s = *session;
+    if (s.applier.status() != DELTA_DONE)
+        return fail("patch incomplete");
+    if (s.out_len > 0 && esp_ota_write(s.handle, s.out_buf, s.out_len) != ESP_OK)
+        return fail("flash write failed");
+    s.out_len = 0;
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&s.sha, digest);
+    mbedtls_sha256_free(&s.sha);
+    if (memcmp(digest, s.header.new_sha256, sizeof(digest)) != 0)
+        return fail("new image hash mismatch");
+    s.ota_started = false;
+    if (esp_ota_end(s.handle) != ESP_OK)
+        return fail("image validation failed");
+
+    // 先保存回滾資訊再切換開機分區
+    preferences.begin("ota", false);
+    preferences.putBool("pending", true);
+    preferences.putString("previous", s.running->label);
+    preferences.putString("target", s.target->label);
+    preferences.putUChar("boots", 0);
+    preferences.end();
+    if (esp_ota_set_boot_partition(s.target) != ESP_OK)
+    {
+        preferences.begin("ota", false);
+        preferences.remove("pending");
+        preferences.end();
+        return fail("esp_ota_set_boot_partition failed");
+    }
+    Serial.printf("OTAManager: update written to %s, restarting soon\n", s.target->label);
+    delete session;
+    session = nullptr;
+    restartAt = millis() + 1000; // 留時間回應 HTTP / MQTT
+    return true;
+}
+
+void OTAManager::abort()
+{
+    if (!session)
+        return;
+    if (session->ota_started)
+    {
+        esp_ota_abort(session->handle);
+        mbedtls_sha256_free(&session->sha);
+    }
+    delete session;
+    session = nullptr;
+}
+
+bool OTAManager::readOld(uint32_t offset, uint8_t *buf, size_t len, void *context)
+{
+    OTAManager *self = static_cast<OTAManager *>(context);
+    return esp_partition_read(self->session->running, offset, buf, len) == ESP_OK;
+}
+
+bool OTAManager::writeNew(const uint8_t *buf, size_t len, void *context)
+{
+    Session &s = *static_cast<OTAManager *>(context)->session;
+    mbedtls_sha256_update(&s.sha, buf, len);
+    while (len > 0)
+    {
+        size_t n = OTA_WRITE_BUFFER - s.out_len;
+        if (n > len)
+            n = len;
+        memcpy(s.out_buf + s.out_len, buf, n);
+        s.out_len += n;
+        buf += n;
+        len -= n;
+        if (s.out_len == OTA_WRITE_BUFFER)
+        {
+            if (esp_ota_write(s.handle, s.out_buf, s.out_len) != ESP_OK)
+                return false;
+            s.out_len = 0;
+        }
+    }
+    return true;
+}
+
+void OTAManager::markHealthy()
+{
+    preferences.begin("ota", false);
+    preferences.remove("pending");
+    preferences.remove("boots");
+    preferences.end();
+    pendingVerify = false;
+    esp_ota_mark_app_valid_cancel_rollback();
+    Serial.println("OTAManager: new image passed health check");
+}
+
+void OTAManager::rollback(const char *reason)
+{
+    Serial.printf("OTAManager: rolling back (%s)\n", reason);
+    preferences.begin("ota", false);
+    String previous = preferences.getString("previous", "");
+    preferences.remove("pending");
+    preferences.remove("boots");
+    preferences.end();
+    pendingVerify = false;
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, previous.c_str());
+    if (!partition || esp_ota_set_boot_partition(partition) != ESP_OK)
+    {
+        Serial.println("OTAManager: previous image unavailable, keeping current image");
+        return;
+    }
+    ESP.restart();
+}
+
+bool OTAManager::applyFromUrl(const char *url)
+{
+    HTTPClient http;
+    if (!http.begin(url))
+        return fail("invalid URL");
+    int code = http.GET();
+    if (code != HTTP_CODE_OK)
+    {
+        http.end();
+        return fail("download failed");
+    }
+    if (!begin())
+    {
+        http.end();
+        return false;
+    }
+    WiFiClient *stream = http.getStreamPtr();
+    int remaining = http.getSize(); // -1 表示長度未知，讀到連線結束
+    uint8_t buf[1024];
+    bool ok = true;
+    unsigned long lastData = millis();
+    while (ok && http.connected() && (remaining > 0 || remaining == -1))
+    {
+        size_t available = stream->available();
+        if (available == 0)
+        {
+            if ((unsigned long)(millis() - lastData) >= OTA_DOWNLOAD_IDLE_TIMEOUT_MS)
+            {
+                http.end();
+                return fail("download timed out");
+            }
+            delay(1);
+            continue;
+        }
+        lastData = millis();
+        int n = stream->readBytes(buf, available < sizeof(buf) ? available : sizeof(buf));
+        ok = write(buf, n);
+        if (remaining > 0)
+            remaining -= n;
+    }
+    http.end();
+    return ok && end();
+}
+
+bool OTAManager::writeFragment(const uint8_t *payload, size_t len)
+{
+    // 失敗只回報一次，之後的片段直到下一個 offset 0 都直接捨棄
+    if (len < 4)
+    {
+        if (fragmentsDiscarded)
+            return true;
+        fragmentsDiscarded = true;
+        return fail("fragment too short");
+    }
+    uint32_t offset = (uint32_t)payload[0] | ((uint32_t)payload[1] << 8) | ((uint32_t)payload[2] << 16) | ((uint32_t)payload[3] << 24);
+    if (fragmentsDiscarded && offset != 0)
+        return true;
+    bool ok = applyFragment(offset, payload + 4, len - 4);
+    fragmentsDiscarded = !ok;
+    return ok;
+}
+
+bool OTAManager::applyFragment(uint32_t offset, const uint8_t *data, size_t len)
+{
+    if (restartAt)
+        return true; // 已完成更新，重複送達的片段不再處理
+    if (offset == 0)
+    {
+        // QoS 1 重新送達的第一段：與已收到的標頭相同就略過，否則視為新的更新
+        size_t n = session ? (len < session->header_len ? len : session->header_len) : 0;
+        if (n > 0 && memcmp(data, session->header_buf, n) == 0)
+            return true;
+        if (!begin())
+            return false;
+    }
+    if (!session)
+        return fail("no update in progress");
+    // 已處理過的片段直接略過；跳過資料則無法繼續
+    if (offset < session->received)
+        return true;
+    if (offset > session->received)
+        return fail("missing patch fragment");
+    if (len == 0)
+        return end();
+    return write(data, len);
+}
+
+void OTAManager::registerRoutes(WebServer &server)
+{
+    // POST application/octet-stream 上傳 patch，或 ?url= 由裝置自行下載
+    server.on(
+        "/ota/delta", HTTP_POST, [this, &server]()
+        {
+        if (server.hasArg("url"))
+            applyFromUrl(server.arg("url").c_str());
+        else if (session)
+            end(); // 上傳途中失敗時 session 已釋放，保留原本的錯誤訊息
+        if (restartAt)
+            server.send(200, "text/plain", "update applied, restarting");
+        else
+            server.send(400, "text/plain", String("update failed: ") + errorMessage); },
+        [this, &server]()
+        {
+            HTTPRaw &raw = server.raw();
+            if (raw.status == RAW_START)
+                errorMessage = "no patch data";
+            // 收到第一段 body 才建立 session；?url= 的請求沒有 body，不會被當成上傳
+            if (raw.status == RAW_WRITE && raw.totalSize == raw.currentSize)
+                begin();
+            if (raw.status == RAW_WRITE && session)
+                write(raw.buf, raw.currentSize);
+            else if (raw.status == RAW_ABORTED)
+                abort();
+        });
+}
+
+#endif // PULMOTE_ENABLE_OTA
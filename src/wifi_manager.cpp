@@ -13,6 +13,15 @@ WiFiManager::WiFiManager() // 建構子初始化
     lastBlinkMillis = 0;
     ledState = false;
     blinkIntervalMs = 200; // 0.2 秒閃爍
+    routeHook = nullptr;
+    serviceServer = false;
+    hasCredentials = false;
+    assocStartMillis = 0;
+}
+
+void WiFiManager::setRouteHook(web_route_hook_t hook)
+{
+    routeHook = hook;
 }
 
 void WiFiManager::init(uint16_t status_pin) // WiFi 初始化流程
@@ -27,6 +36,8 @@ void WiFiManager::init(uint16_t status_pin) // WiFi 初始化流程
     String storedPwd = preferences.getString("password", "");
     Serial.printf("Preferences read: ssid='%s' password_len=%u\n", storedSsid.c_str(), (unsigned)storedPwd.length());
     WiFi.mode(WIFI_MODE_STA); // 設定 WiFi 模式為 Station
+    hasCredentials = storedSsid != "" && storedPwd != "";
+    assocStartMillis = millis();
     if (WiFi.status() == WL_CONNECTED)
     {
         Serial.println("WiFiManager: already connected to WiFi");
@@ -113,13 +124,33 @@ void WiFiManager::startWebServer() // 處理 Web Server 的 Client 請求
         Serial.printf("Preferences write: ssid='%s' password_len=%u\n", ssid.c_str(), (unsigned)pass.length());
         preferences.end();
         // start connecting
+        hasCredentials = true;
+        assocStartMillis = millis();
         WiFi.mode(WIFI_MODE_APSTA);
         WiFi.begin(ssid.c_str(), pass.c_str());
         if (webServer) webServer->send(200, "text/plain", "connecting"); });
 
     // No status/debug endpoints (removed per request)
 
+    if (routeHook)
+        routeHook(*webServer);
+
+    webServer->begin();
+}
+
+void WiFiManager::startServiceServer()
+{
+    // 設定頁在連上 WiFi 後會關閉，其他模組的路由（IR 備份、OTA）改由此 Server 在區網提供
+    if (webServer || !routeHook)
+        return;
+    webServer = new WebServer(80);
+    routeHook(*webServer);
+    webServer->onNotFound([this]()
+                          {
+        if (webServer) webServer->send(404, "text/plain", "Not Found"); });
     webServer->begin();
+    serviceServer = true;
+    Serial.printf("WiFiManager: service web server on http://%s/\n", WiFi.localIP().toString().c_str());
 }
 
 void WiFiManager::stopWebServer()
@@ -129,6 +160,7 @@ void WiFiManager::stopWebServer()
     webServer->stop();
     delete webServer;
     webServer = nullptr;
+    serviceServer = false;
 }
 void WiFiManager::startAPMode() // 啟動 AP 模式
 {
@@ -160,7 +192,9 @@ void WiFiManager::startAPMode() // 啟動 AP 模式
     {
         Serial.println("WiFiManager: softAP start failed");
     }
-    // 啟動 Web Server 供設定使用
+    // 啟動 Web Server 供設定使用，先關閉連線期間的服務 Server
+    if (serviceServer)
+        stopWebServer();
     startWebServer();
 }
 
@@ -191,6 +225,35 @@ WiFiManager::~WiFiManager()
     preferences.end();
 }
 
+bool WiFiManager::waitForConnection(uint32_t timeout_ms)
+{
+    if (!hasCredentials)
+    {
+        Serial.println("WiFiManager: no stored credentials, not waiting for association");
+        return false;
+    }
+    // Arduino core 在 GOT_IP 事件後才回報 WL_CONNECTED，返回時已可使用網路
+    unsigned long start = millis();
+    while (WiFi.status() != WL_CONNECTED)
+    {
+        if ((unsigned long)(millis() - start) >= timeout_ms)
+        {
+            Serial.printf("WiFiManager: association timed out after %lu ms\n", (unsigned long)timeout_ms);
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+bool WiFiManager::needsProvisioning()
+{
+    if (!hasCredentials)
+        return true;
+    // 連線期間 loop() 持續更新 assocStartMillis，斷線或連不上超過時限才需要重新設定
+    return WiFi.status() != WL_CONNECTED && (unsigned long)(millis() - assocStartMillis) >= WIFI_ASSOC_TIMEOUT_MS;
+}
+
 bool WiFiManager::isAPActive()
 {
     // 對 ESP32 Arduino core：WiFi.getMode() 回傳 wifi_mode_t
@@ -282,11 +345,14 @@ void WiFiManager::loop() // 主循環處理
         }
         break;
     case WL_CONNECTED:
+        assocStartMillis = millis();
         /*關閉AP Mode並且關閉web server*/
         if (WiFi.isConnected() && isAPActive())
         {
             stopAPMode();
         }
+        if (!webServer)
+            startServiceServer();
         break;
     case WL_CONNECT_FAILED:
         /*保持AP Mode開啟並且開啟web server*/
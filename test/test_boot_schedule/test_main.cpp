@@ -0,0 +1,256 @@
+// 開機排程單元測試：pio test -e native -f test_boot_schedule
+#include <unity.h>
+#include "boot_schedule.h"
+#include "module_registry.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void noop() {}
+
+static void test_independent_tasks_start_together()
+{
+    BootSchedule s;
+    int wifi = s.add("wifi", noop, "", false);
+    int ir = s.add("ir", noop, "", false);
+    int mqtt = s.add("mqtt", noop, "wifi,ir", false);
+    TEST_ASSERT_TRUE(s.resolve());
+
+    // 沒有相依的模組同時就緒，不必等前一個完成
+    TEST_ASSERT_EQUAL(wifi, s.nextReady(100));
+    TEST_ASSERT_EQUAL(ir, s.nextReady(100));
+    TEST_ASSERT_EQUAL(-1, s.nextReady(100));
+    TEST_ASSERT_EQUAL(2, s.running());
+    TEST_ASSERT_EQUAL(BootTaskInfo::RUNNING, s.task(wifi).state);
+
+    s.markDone(ir, 100, 300);
+    TEST_ASSERT_EQUAL(-1, s.nextReady(300)); // mqtt 仍在等 wifi
+    TEST_ASSERT_FALSE(s.finished());
+    s.markDone(wifi, 100, 900);
+    TEST_ASSERT_EQUAL(mqtt, s.nextReady(900));
+    TEST_ASSERT_EQUAL(1, s.running());
+    s.markDone(mqtt, 900, 1000);
+    TEST_ASSERT_TRUE(s.finished());
+    TEST_ASSERT_EQUAL(0, s.running());
+
+    TEST_ASSERT_EQUAL(900, s.task(mqtt).start_us);
+    TEST_ASSERT_EQUAL(1000, s.task(mqtt).end_us);
+}
+
+static void test_dependency_order()
+{
+    // 依相反順序加入，啟動順序仍由相依決定
+    BootSchedule s;
+    int d = s.add("d", noop, "c", false);
+    int c = s.add("c", noop, "b", false);
+    int b = s.add("b", noop, "a", false);
+    int a = s.add("a", noop, "", false);
+    TEST_ASSERT_TRUE(s.resolve());
+
+    const int expected[] = {a, b, c, d};
+    for (int i = 0; i < 4; ++i)
+    {
+        int index = s.nextReady(i);
+        TEST_ASSERT_EQUAL(expected[i], index);
+        TEST_ASSERT_EQUAL(-1, s.nextReady(i));
+        s.markDone(index, i, i + 1);
+    }
+    TEST_ASSERT_TRUE(s.finished());
+    TEST_ASSERT_EQUAL(-1, s.nextReady(10));
+}
+
+static void test_lazy_task_starts_on_demand()
+{
+    BootSchedule s;
+    int wifi = s.add("wifi", noop, "", false);
+    int ble = s.add("ble", noop, "wifi", true);
+    TEST_ASSERT_TRUE(s.resolve());
+    TEST_ASSERT_EQUAL(ble, s.find("ble"));
+
+    TEST_ASSERT_FALSE(s.startLazy(ble, 0)); // wifi 尚未完成
+    TEST_ASSERT_EQUAL(wifi, s.nextReady(0));
+    TEST_ASSERT_EQUAL(-1, s.nextReady(0)); // lazy 模組不在開機時啟動
+    s.markDone(wifi, 0, 50);
+    TEST_ASSERT_TRUE(s.finished()); // 不等 lazy 模組
+    TEST_ASSERT_EQUAL(BootTaskInfo::PENDING, s.task(ble).state);
+
+    TEST_ASSERT_TRUE(s.startLazy(ble, 5000));
+    TEST_ASSERT_EQUAL(BootTaskInfo::RUNNING, s.task(ble).state);
+    TEST_ASSERT_FALSE(s.startLazy(ble, 5001)); // 已啟動
+    s.markDone(ble, 5000, 5200);
+    TEST_ASSERT_EQUAL(BootTaskInfo::DONE, s.task(ble).state);
+    TEST_ASSERT_FALSE(s.startLazy(ble, 6000));
+    TEST_ASSERT_FALSE(s.startLazy(-1, 6000));
+    TEST_ASSERT_FALSE(s.startLazy(5, 6000));
+}
+
+static void test_rejects_cycles()
+{
+    BootSchedule s;
+    s.add("a", noop, "c", false);
+    s.add("b", noop, "a", false);
+    s.add("c", noop, "b", false);
+    TEST_ASSERT_FALSE(s.resolve());
+    TEST_ASSERT_EQUAL(-1, s.nextReady(0)); // 未通過 resolve() 不會啟動任何模組
+
+    BootSchedule self;
+    self.add("a", noop, "a", false);
+    TEST_ASSERT_FALSE(self.resolve());
+}
+
+static void test_rejects_unknown_names()
+{
+    BootSchedule s;
+    s.add("wifi", noop, "", false);
+    s.add("mqtt", noop, "wifi,ntp", false);
+    TEST_ASSERT_FALSE(s.resolve());
+
+    // 名稱需完整相同，前綴不算
+    BootSchedule prefix;
+    prefix.add("wifi", noop, "", false);
+    prefix.add("mqtt", noop, "wif", false);
+    TEST_ASSERT_FALSE(prefix.resolve());
+    TEST_ASSERT_EQUAL(-1, prefix.find("wif"));
+}
+
+static void test_rejects_eager_dependency_on_lazy()
+{
+    // 開機階段永遠等不到 lazy 模組
+    BootSchedule s;
+    s.add("ble", noop, "", true);
+    s.add("mqtt", noop, "ble", false);
+    TEST_ASSERT_FALSE(s.resolve());
+
+    // lazy 相依 lazy 可以
+    BootSchedule ok;
+    ok.add("ble", noop, "", true);
+    ok.add("provision", noop, "ble", true);
+    TEST_ASSERT_TRUE(ok.resolve());
+    TEST_ASSERT_TRUE(ok.finished());
+}
+
+static void test_add_rejects_duplicates_and_overflow()
+{
+    BootSchedule s;
+    TEST_ASSERT_EQUAL(0, s.add("wifi", noop, "", false));
+    TEST_ASSERT_EQUAL(-1, s.add("wifi", noop, "", false));
+    static const char *names[] = {"m1", "m2", "m3", "m4", "m5", "m6", "m7", "m8", "m9"};
+    for (size_t i = 1; i < BOOT_MAX_TASKS; ++i)
+        TEST_ASSERT_EQUAL((int)i, s.add(names[i - 1], noop, "", false));
+    TEST_ASSERT_EQUAL(-1, s.add("extra", noop, "", false));
+    TEST_ASSERT_EQUAL(BOOT_MAX_TASKS, s.count());
+    TEST_ASSERT_TRUE(s.resolve());
+}
+
+static void test_background_tasks_do_not_delay_ready()
+{
+    BootSchedule s;
+    int wifi = s.add("wifi", noop, "", false);
+    int assoc = s.add("assoc", noop, "wifi", false, true);
+    int mqtt = s.add("mqtt", noop, "assoc", false);
+    int ir = s.add("ir", noop, "", false);
+    TEST_ASSERT_TRUE(s.resolve());
+    TEST_ASSERT_TRUE(s.task(assoc).background);
+    TEST_ASSERT_TRUE(s.task(mqtt).background); // 相依 background 模組
+    TEST_ASSERT_FALSE(s.task(ir).background);
+
+    TEST_ASSERT_EQUAL(wifi, s.nextReady(0));
+    TEST_ASSERT_EQUAL(ir, s.nextReady(0));
+    s.markDone(wifi, 0, 40);
+    TEST_ASSERT_EQUAL(assoc, s.nextReady(40));
+    s.markDone(ir, 0, 50);
+    TEST_ASSERT_TRUE(s.foregroundFinished()); // 不等 WiFi 連線
+    TEST_ASSERT_FALSE(s.finished());
+
+    TEST_ASSERT_EQUAL(-1, s.nextReady(60));
+    s.markDone(assoc, 40, 2000);
+    TEST_ASSERT_EQUAL(mqtt, s.nextReady(2000));
+    s.markDone(mqtt, 2000, 2100);
+    TEST_ASSERT_TRUE(s.finished());
+
+    // 重新 resolve() 不會殘留推導結果
+    BootSchedule again;
+    again.add("a", noop, "", false, true);
+    again.add("b", noop, "a", false);
+    TEST_ASSERT_TRUE(again.resolve());
+    TEST_ASSERT_TRUE(again.resolve());
+    TEST_ASSERT_TRUE(again.task(1).background);
+    TEST_ASSERT_TRUE(again.foregroundFinished()); // 只有 background 模組
+    TEST_ASSERT_FALSE(again.finished());
+}
+
+static int onLoops = 0;
+static int lazyLoops = 0;
+
+struct OnModule
+{
+    static const bool enabled = true;
+    static const bool lazy = false;
+    static const bool background = false;
+    static const char *name() { return "on"; }
+    static const char *deps() { return ""; }
+    static void init() {}
+    static void loop() { ++onLoops; }
+};
+
+struct LazyModule
+{
+    static const bool enabled = true;
+    static const bool lazy = true;
+    static const bool background = false;
+    static const char *name() { return "lazy"; }
+    static const char *deps() { return "on"; }
+    static void init() {}
+    static void loop() { ++lazyLoops; }
+};
+
+// 以 BootSchedule 提供 isDone()，與 BootOrchestrator 相同
+struct ScheduleSink
+{
+    BootSchedule &s;
+    bool isDone(const char *name) const
+    {
+        int index = s.find(name);
+        return index >= 0 && s.task(index).state == BootTaskInfo::DONE;
+    }
+};
+
+struct OffModule : DisabledModule
+{
+};
+
+static void test_module_list_registers_enabled_modules()
+{
+    typedef ModuleList<OnModule, OffModule, LazyModule> Modules;
+    TEST_ASSERT_EQUAL(2, Modules::enabledCount);
+    BootSchedule s;
+    Modules::registerAll(s);
+    TEST_ASSERT_EQUAL(2, s.count());
+    TEST_ASSERT_TRUE(s.resolve());
+    TEST_ASSERT_TRUE(s.task(s.find("lazy")).lazy);
+
+    // init() 完成前不呼叫 loop()
+    ScheduleSink sink = {s};
+    Modules::loopAll(sink);
+    TEST_ASSERT_EQUAL(0, onLoops);
+    int on = s.nextReady(0);
+    s.markDone(on, 0, 1);
+    Modules::loopAll(sink);
+    TEST_ASSERT_EQUAL(1, onLoops);
+    TEST_ASSERT_EQUAL(0, lazyLoops);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_independent_tasks_start_together);
+    RUN_TEST(test_dependency_order);
+    RUN_TEST(test_lazy_task_starts_on_demand);
+    RUN_TEST(test_rejects_cycles);
+    RUN_TEST(test_rejects_unknown_names);
+    RUN_TEST(test_rejects_eager_dependency_on_lazy);
+    RUN_TEST(test_add_rejects_duplicates_and_overflow);
+    RUN_TEST(test_background_tasks_do_not_delay_ready);
+    RUN_TEST(test_module_list_registers_enabled_modules);
+    return UNITY_END();
+}
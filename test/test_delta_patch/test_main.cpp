@@ -0,0 +1,401 @@
+// 韌體差異更新單元測試與效能量測：pio test -e native -f test_delta_patch -v
+//
+// 以實際韌體量測 patch 大小與套用速度（未設定時略過）:
+//
+//   python3 scripts/delta_ota.py diff old.bin new.bin update.pdlt
+//   export PULMOTE_DELTA_OLD=old.bin PULMOTE_DELTA_NEW=new.bin PULMOTE_DELTA_PATCH=update.pdlt
+//   pio test -e native -f test_delta_patch -v
+//
+// 裝置端以 ROM tinfl 解壓，這裡以 zlib 解壓同樣的 raw deflate 串流。
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "delta_patch.h"
+
+#define MAX_FRAGMENT 4096
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Image
+{
+    const Bytes *old_image;
+    Bytes out;
+    size_t fail_write_at; // 輸出超過此位置時寫入失敗，模擬 flash 錯誤
+};
+
+static uint32_t rngState;
+
+static uint32_t nextRandom()
+{
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static bool readOld(uint32_t offset, uint8_t *buf, size_t len, void *context)
+{
+    Image *img = static_cast<Image *>(context);
+    if (offset + len > img->old_image->size())
+        return false;
+    memcpy(buf, img->old_image->data() + offset, len);
+    return true;
+}
+
+static bool writeNew(const uint8_t *buf, size_t len, void *context)
+{
+    Image *img = static_cast<Image *>(context);
+    if (img->out.size() + len > img->fail_write_at)
+        return false;
+    img->out.insert(img->out.end(), buf, buf + len);
+    return true;
+}
+
+static void putVarint(Bytes &ops, uint32_t value)
+{
+    do
+    {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        ops.push_back(value ? (uint8_t)(byte | 0x80) : byte);
+    } while (value);
+}
+
+static uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+// 組指令流的輔助函式，last_old 追蹤上一個 COPY / DIFF 結束的位置
+struct OpWriter
+{
+    Bytes ops;
+    uint32_t last_old;
+
+    OpWriter() : last_old(0) {}
+
+    void copy(uint32_t old_pos, uint32_t len)
+    {
+        ops.push_back(0x01);
+        putVarint(ops, zigzag((int32_t)(old_pos - last_old)));
+        putVarint(ops, len);
+        last_old = old_pos + len;
+    }
+
+    void add(const uint8_t *data, uint32_t len)
+    {
+        ops.push_back(0x02);
+        putVarint(ops, len);
+        ops.insert(ops.end(), data, data + len);
+    }
+
+    void diff(uint32_t old_pos, const uint8_t *delta, uint32_t len)
+    {
+        ops.push_back(0x03);
+        putVarint(ops, zigzag((int32_t)(old_pos - last_old)));
+        putVarint(ops, len);
+        ops.insert(ops.end(), delta, delta + len);
+        last_old = old_pos + len;
+    }
+
+    void end() { ops.push_back(0x00); }
+};
+
+static DeltaPatchStatus applyOps(const Bytes &old_image, const Bytes &ops, uint32_t new_size, Image &img, bool random_fragments)
+{
+    DeltaPatchApplier *applier = new DeltaPatchApplier();
+    img.old_image = &old_image;
+    img.out.clear();
+    applier->begin((uint32_t)old_image.size(), new_size, readOld, writeNew, &img);
+    DeltaPatchStatus status = DELTA_NEED_MORE;
+    size_t pos = 0;
+    while (pos < ops.size() && status == DELTA_NEED_MORE)
+    {
+        size_t n = random_fragments ? 1 + nextRandom() % MAX_FRAGMENT : ops.size() - pos;
+        if (n > ops.size() - pos)
+            n = ops.size() - pos;
+        status = applier->feed(ops.data() + pos, n);
+        pos += n;
+    }
+    if (pos < ops.size() && status == DELTA_DONE)
+        status = applier->feed(ops.data() + pos, ops.size() - pos);
+    delete applier;
+    return status;
+}
+
+static Image freshImage()
+{
+    Image img;
+    img.old_image = nullptr;
+    img.fail_write_at = (size_t)-1;
+    return img;
+}
+
+static Bytes readFile(const char *path)
+{
+    Bytes data;
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return data;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    return data;
+}
+
+void setUp()
+{
+    rngState = 88172645u;
+}
+
+void tearDown() {}
+
+static void test_round_trip_random_fragments()
+{
+    // 模擬韌體更新：大部分相同、部分位址偏移、中間插入新程式碼、區段搬移
+    Bytes old_image(256 * 1024);
+    for (size_t i = 0; i < old_image.size(); ++i)
+        old_image[i] = (uint8_t)nextRandom();
+
+    Bytes inserted(3000);
+    for (size_t i = 0; i < inserted.size(); ++i)
+        inserted[i] = (uint8_t)nextRandom();
+
+    Bytes expected;
+    OpWriter w;
+    // 0 .. 64K 不變
+    w.copy(0, 65536);
+    expected.insert(expected.end(), old_image.begin(), old_image.begin() + 65536);
+    // 64K .. 128K 每 64 bytes 有一個位址加 4
+    Bytes delta(65536, 0);
+    for (size_t i = 0; i < delta.size(); i += 64)
+        delta[i] = 4;
+    w.diff(65536, delta.data(), (uint32_t)delta.size());
+    for (size_t i = 0; i < delta.size(); ++i)
+        expected.push_back((uint8_t)(old_image[65536 + i] + delta[i]));
+    // 新增的程式碼
+    w.add(inserted.data(), (uint32_t)inserted.size());
+    expected.insert(expected.end(), inserted.begin(), inserted.end());
+    // 192K .. 256K 搬到 128K .. 192K 之前（offset 向前與向後跳）
+    w.copy(196608, 65536);
+    expected.insert(expected.end(), old_image.begin() + 196608, old_image.end());
+    w.copy(131072, 65536);
+    expected.insert(expected.end(), old_image.begin() + 131072, old_image.begin() + 196608);
+    w.add(inserted.data(), 0); // 長度 0 的指令
+    w.end();
+
+    for (int round = 0; round < 20; ++round)
+    {
+        Image img = freshImage();
+        TEST_ASSERT_EQUAL(DELTA_DONE, applyOps(old_image, w.ops, (uint32_t)expected.size(), img, true));
+        TEST_ASSERT_EQUAL(expected.size(), img.out.size());
+        TEST_ASSERT_TRUE(img.out == expected);
+    }
+
+    // 每次只輸入一個位元組
+    DeltaPatchApplier *applier = new DeltaPatchApplier();
+    Image img = freshImage();
+    img.old_image = &old_image;
+    applier->begin((uint32_t)old_image.size(), (uint32_t)expected.size(), readOld, writeNew, &img);
+    for (size_t i = 0; i < w.ops.size(); ++i)
+        applier->feed(&w.ops[i], 1);
+    TEST_ASSERT_EQUAL(DELTA_DONE, applier->status());
+    TEST_ASSERT_EQUAL(expected.size(), applier->written());
+    TEST_ASSERT_TRUE(img.out == expected);
+    delete applier;
+}
+
+static void test_rejects_bad_ops()
+{
+    Bytes old_image(1024, 0x55);
+    Image img = freshImage();
+
+    Bytes unknown(1, 0x07);
+    TEST_ASSERT_EQUAL(DELTA_BAD_OP, applyOps(old_image, unknown, 16, img, false));
+
+    // varint 超過 32 bits
+    Bytes overflow;
+    overflow.push_back(0x02);
+    for (int i = 0; i < 5; ++i)
+        overflow.push_back(0xFF);
+    overflow.push_back(0x01);
+    TEST_ASSERT_EQUAL(DELTA_BAD_OP, applyOps(old_image, overflow, 16, img, false));
+}
+
+static void test_rejects_out_of_range()
+{
+    Bytes old_image(1024, 0x55);
+    Image img = freshImage();
+
+    OpWriter past_old; // 讀取超出舊映像
+    past_old.copy(1000, 100);
+    past_old.end();
+    TEST_ASSERT_EQUAL(DELTA_OUT_OF_RANGE, applyOps(old_image, past_old.ops, 100, img, false));
+
+    OpWriter before_old; // offset 差值使位置小於 0
+    before_old.ops.push_back(0x01);
+    putVarint(before_old.ops, zigzag(-1));
+    putVarint(before_old.ops, 1);
+    TEST_ASSERT_EQUAL(DELTA_OUT_OF_RANGE, applyOps(old_image, before_old.ops, 1, img, false));
+
+    OpWriter past_new; // 輸出超過新映像大小
+    past_new.copy(0, 200);
+    TEST_ASSERT_EQUAL(DELTA_OUT_OF_RANGE, applyOps(old_image, past_new.ops, 100, img, false));
+
+    OpWriter short_new; // END 時輸出不足
+    short_new.copy(0, 50);
+    short_new.end();
+    TEST_ASSERT_EQUAL(DELTA_OUT_OF_RANGE, applyOps(old_image, short_new.ops, 100, img, false));
+}
+
+static void test_rejects_trailing_data_and_io_errors()
+{
+    Bytes old_image(4096, 0x11);
+    Image img = freshImage();
+
+    OpWriter trailing;
+    trailing.copy(0, 16);
+    trailing.end();
+    trailing.ops.push_back(0x00);
+    TEST_ASSERT_EQUAL(DELTA_TRAILING_DATA, applyOps(old_image, trailing.ops, 16, img, false));
+
+    OpWriter copy;
+    copy.copy(0, 4096);
+    copy.end();
+    img.fail_write_at = 2000;
+    TEST_ASSERT_EQUAL(DELTA_IO_ERROR, applyOps(old_image, copy.ops, 4096, img, false));
+
+    Bytes delta(4096, 1);
+    OpWriter diff;
+    diff.diff(0, delta.data(), (uint32_t)delta.size());
+    diff.end();
+    img = freshImage();
+    img.fail_write_at = 3000;
+    TEST_ASSERT_EQUAL(DELTA_IO_ERROR, applyOps(old_image, diff.ops, 4096, img, false));
+}
+
+static void test_parse_header()
+{
+    uint8_t header[DELTA_PATCH_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    memcpy(header, "PDLT", 4);
+    header[4] = DELTA_PATCH_VERSION;
+    header[5] = DELTA_FLAG_DEFLATE;
+    header[8] = 0x00;
+    header[9] = 0x10; // old_size = 4096
+    header[12] = 0x01;
+    header[14] = 0x01; // new_size = 65537
+    header[16] = 0xAA;
+    header[48] = 0xBB;
+    DeltaPatchHeader parsed;
+    TEST_ASSERT_TRUE(deltaPatchParseHeader(header, parsed));
+    TEST_ASSERT_EQUAL(DELTA_FLAG_DEFLATE, parsed.flags);
+    TEST_ASSERT_EQUAL(4096, parsed.old_size);
+    TEST_ASSERT_EQUAL(65537, parsed.new_size);
+    TEST_ASSERT_EQUAL(0xAA, parsed.old_sha256[0]);
+    TEST_ASSERT_EQUAL(0xBB, parsed.new_sha256[0]);
+    TEST_ASSERT_EQUAL(DELTA_PATCH_HEADER_SIZE, deltaPatchDataOffset(parsed));
+    parsed.flags |= DELTA_FLAG_SIGNED;
+    TEST_ASSERT_EQUAL(DELTA_PATCH_HEADER_SIZE + DELTA_PATCH_SIGNATURE_SIZE, deltaPatchDataOffset(parsed));
+
+    header[4] = DELTA_PATCH_VERSION + 1;
+    TEST_ASSERT_FALSE(deltaPatchParseHeader(header, parsed));
+    header[4] = DELTA_PATCH_VERSION;
+    header[0] = 'X';
+    TEST_ASSERT_FALSE(deltaPatchParseHeader(header, parsed));
+}
+
+static void test_firmware_patch_benchmark()
+{
+    const char *old_path = getenv("PULMOTE_DELTA_OLD");
+    const char *new_path = getenv("PULMOTE_DELTA_NEW");
+    const char *patch_path = getenv("PULMOTE_DELTA_PATCH");
+    if (!old_path || !new_path || !patch_path)
+        TEST_IGNORE_MESSAGE("set PULMOTE_DELTA_OLD / PULMOTE_DELTA_NEW / PULMOTE_DELTA_PATCH to benchmark a firmware pair");
+    Bytes old_image = readFile(old_path);
+    Bytes new_image = readFile(new_path);
+    Bytes patch = readFile(patch_path);
+    TEST_ASSERT_TRUE(patch.size() > DELTA_PATCH_HEADER_SIZE);
+
+    DeltaPatchHeader header;
+    TEST_ASSERT_TRUE(deltaPatchParseHeader(patch.data(), header));
+    TEST_ASSERT_EQUAL(old_image.size(), header.old_size);
+    TEST_ASSERT_EQUAL(new_image.size(), header.new_size);
+
+    // 與裝置相同：片段邊解壓邊交給 applier，只保留一個輸出緩衝區
+    Image img = freshImage();
+    img.old_image = &old_image;
+    img.out.reserve(new_image.size());
+    DeltaPatchApplier *applier = new DeltaPatchApplier();
+    applier->begin(header.old_size, header.new_size, readOld, writeNew, &img);
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    bool deflate = (header.flags & DELTA_FLAG_DEFLATE) != 0;
+    if (deflate)
+        TEST_ASSERT_EQUAL(Z_OK, inflateInit2(&z, -15));
+    uint8_t out[MAX_FRAGMENT];
+    size_t ops_bytes = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t pos = deltaPatchDataOffset(header);
+    while (pos < patch.size() && applier->status() == DELTA_NEED_MORE)
+    {
+        size_t n = 1 + nextRandom() % 1460; // 約一個 TCP 區段
+        if (n > patch.size() - pos)
+            n = patch.size() - pos;
+        if (!deflate)
+        {
+            applier->feed(patch.data() + pos, n);
+            ops_bytes += n;
+            pos += n;
+            continue;
+        }
+        z.next_in = patch.data() + pos;
+        z.avail_in = (uInt)n;
+        do
+        {
+            z.next_out = out;
+            z.avail_out = sizeof(out);
+            int rc = inflate(&z, Z_NO_FLUSH);
+            TEST_ASSERT_TRUE(rc == Z_OK || rc == Z_STREAM_END || rc == Z_BUF_ERROR);
+            size_t produced = sizeof(out) - z.avail_out;
+            ops_bytes += produced;
+            if (produced > 0)
+                applier->feed(out, produced);
+        } while (z.avail_out == 0 && applier->status() == DELTA_NEED_MORE);
+        pos += n;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (deflate)
+        inflateEnd(&z);
+
+    TEST_ASSERT_EQUAL(DELTA_DONE, applier->status());
+    TEST_ASSERT_TRUE(img.out == new_image);
+    delete applier;
+
+    double mb = new_image.size() / (1024.0 * 1024.0);
+    printf("Delta patch: old=%u new=%u patch=%u (%.1f%% of new), ops=%u bytes\n",
+           (unsigned)old_image.size(), (unsigned)new_image.size(), (unsigned)patch.size(),
+           100.0 * patch.size() / new_image.size(), (unsigned)ops_bytes);
+    printf("Delta patch: applied %.2f MB in %.3f s (%.1f MB/s on host), sizeof(DeltaPatchApplier)=%u\n",
+           mb, seconds, mb / seconds, (unsigned)sizeof(DeltaPatchApplier));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_random_fragments);
+    RUN_TEST(test_rejects_bad_ops);
+    RUN_TEST(test_rejects_out_of_range);
+    RUN_TEST(test_rejects_trailing_data_and_io_errors);
+    RUN_TEST(test_parse_header);
+    RUN_TEST(test_firmware_patch_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,354 @@
+// 紅外線指令庫備份格式單元測試：pio test -e native -f test_ir_bundle -v
+// 以約 1 MB 的指令庫雙向串流，並印出吞吐量與編碼器 / 解碼器的記憶體用量
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <chrono>
+#include <vector>
+#include "ir_bundle.h"
+
+#define BUNDLE_TARGET_BYTES (1024 * 1024)
+#define MAX_FRAGMENT 3000
+
+// 計算串流期間的 heap 配置次數，編碼與解碼都應該只使用物件本身的緩衝區
+static size_t heapAllocations = 0;
+
+__attribute__((noinline)) void *operator new(size_t size)
+{
+    ++heapAllocations;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+static uint32_t rngState;
+
+static uint32_t nextRandom()
+{
+    // xorshift32，固定種子讓片段大小可重現
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static size_t randomFragment()
+{
+    return 1 + nextRandom() % MAX_FRAGMENT;
+}
+
+static uint16_t sampleCount(uint32_t index)
+{
+    return (uint16_t)(index * 37 % (IR_BUNDLE_MAX_SAMPLES + 1));
+}
+
+static uint16_t sampleValue(uint32_t index, uint32_t k)
+{
+    return (uint16_t)(300 + (index * 131 + k * 17) % 9000);
+}
+
+static void recordName(uint32_t index, char *name)
+{
+    snprintf(name, IR_BUNDLE_MAX_NAME + 1, "code_%05u", (unsigned)index);
+}
+
+static uint32_t recordsForTarget()
+{
+    uint32_t count = 0;
+    size_t bytes = IR_BUNDLE_HEADER_SIZE + IR_BUNDLE_TRAILER_SIZE;
+    while (bytes < BUNDLE_TARGET_BYTES)
+        bytes += IR_BUNDLE_RECORD_OVERHEAD + 10 + (size_t)sampleCount(count++) * 2;
+    return count;
+}
+
+// 以隨機大小的片段讀出整個備份
+static void encodeBundle(IRBundleWriter &writer, uint32_t count, std::vector<uint8_t> &out)
+{
+    uint8_t buf[MAX_FRAGMENT];
+    size_t n;
+    writer.begin(count);
+    for (uint32_t i = 0; i <= count; ++i)
+    {
+        while ((n = writer.read(buf, randomFragment())) > 0)
+            out.insert(out.end(), buf, buf + n);
+        if (i == count)
+            break;
+        char name[IR_BUNDLE_MAX_NAME + 1];
+        recordName(i, name);
+        uint16_t samples = sampleCount(i);
+        uint8_t *data = writer.beginRecord(name, samples);
+        TEST_ASSERT_NOT_NULL(data);
+        for (uint32_t k = 0; k < samples; ++k)
+        {
+            uint16_t v = sampleValue(i, k);
+            data[k * 2] = (uint8_t)(v & 0xFF);
+            data[k * 2 + 1] = (uint8_t)(v >> 8);
+        }
+        writer.commitRecord();
+    }
+    writer.finish();
+    while ((n = writer.read(buf, randomFragment())) > 0)
+        out.insert(out.end(), buf, buf + n);
+}
+
+static std::vector<uint8_t> makeBundle(uint32_t count)
+{
+    IRBundleWriter *writer = new IRBundleWriter();
+    std::vector<uint8_t> out;
+    encodeBundle(*writer, count, out);
+    delete writer;
+    return out;
+}
+
+struct Verify
+{
+    uint32_t next; // 預期的下一筆紀錄
+    bool ok;
+    uint32_t reject_at; // 回呼在此紀錄回傳 false
+};
+
+static bool verifyRecord(const IRBundleRecord &record, void *context)
+{
+    Verify *v = static_cast<Verify *>(context);
+    if (v->next == v->reject_at)
+        return false;
+    char name[IR_BUNDLE_MAX_NAME + 1];
+    recordName(v->next, name);
+    bool ok = record.name_len == strlen(name) && memcmp(record.name, name, record.name_len) == 0 &&
+              record.sample_count == sampleCount(v->next);
+    for (uint32_t k = 0; ok && k < record.sample_count; ++k)
+        ok = (uint16_t)(record.samples[k * 2] | (record.samples[k * 2 + 1] << 8)) == sampleValue(v->next, k);
+    if (!ok)
+        v->ok = false;
+    ++v->next;
+    return true;
+}
+
+static IRBundleStatus decodeFrom(IRBundleReader &reader, const std::vector<uint8_t> &data, size_t start, size_t end, Verify &v)
+{
+    IRBundleStatus status = reader.status();
+    size_t pos = start;
+    while (pos < end && status == IR_BUNDLE_NEED_MORE)
+    {
+        size_t n = randomFragment();
+        if (n > end - pos)
+            n = end - pos;
+        status = reader.feed(data.data() + pos, n, verifyRecord, &v);
+        pos += n;
+    }
+    return status;
+}
+
+static IRBundleStatus decodeAll(const std::vector<uint8_t> &data, Verify &v)
+{
+    IRBundleReader *reader = new IRBundleReader();
+    reader->begin();
+    IRBundleStatus status = decodeFrom(*reader, data, 0, data.size(), v);
+    delete reader;
+    return status;
+}
+
+static Verify freshVerify()
+{
+    Verify v = {0, true, 0xFFFFFFFF};
+    return v;
+}
+
+void setUp()
+{
+    rngState = 2463534242u;
+}
+
+void tearDown() {}
+
+static void test_round_trip_1mb_random_fragments()
+{
+    uint32_t count = recordsForTarget();
+    IRBundleWriter *writer = new IRBundleWriter();
+    IRBundleReader *reader = new IRBundleReader();
+    std::vector<uint8_t> bundle;
+    bundle.reserve(BUNDLE_TARGET_BYTES + IR_BUNDLE_MAX_FRAME);
+
+    size_t before = heapAllocations;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    encodeBundle(*writer, count, bundle);
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    Verify v = freshVerify();
+    reader->begin();
+    IRBundleStatus status = decodeFrom(*reader, bundle, 0, bundle.size(), v);
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+    size_t allocations = heapAllocations - before;
+
+    TEST_ASSERT_TRUE(bundle.size() >= BUNDLE_TARGET_BYTES);
+    TEST_ASSERT_EQUAL(count, writer->recordsWritten());
+    TEST_ASSERT_EQUAL(IR_BUNDLE_DONE, status);
+    TEST_ASSERT_TRUE(v.ok);
+    TEST_ASSERT_EQUAL(count, v.next);
+    TEST_ASSERT_EQUAL(0, allocations); // 只用物件內的一筆紀錄緩衝區
+
+    double mb = bundle.size() / (1024.0 * 1024.0);
+    printf("IR bundle: %u records, %u bytes, fragments 1..%d B\n", (unsigned)count, (unsigned)bundle.size(), MAX_FRAGMENT);
+    printf("IR bundle: encode %.1f MB/s, decode %.1f MB/s\n",
+           mb / std::chrono::duration<double>(t1 - t0).count(), mb / std::chrono::duration<double>(t2 - t1).count());
+    printf("IR bundle: sizeof(IRBundleWriter)=%u sizeof(IRBundleReader)=%u, heap allocations while streaming=%u\n",
+           (unsigned)sizeof(IRBundleWriter), (unsigned)sizeof(IRBundleReader), (unsigned)allocations);
+    delete writer;
+    delete reader;
+}
+
+static void test_resume_from_checkpoint()
+{
+    uint32_t count = recordsForTarget();
+    std::vector<uint8_t> bundle = makeBundle(count);
+    Verify v = freshVerify();
+    IRBundleReader *reader = new IRBundleReader();
+    reader->begin();
+
+    // 在隨機位置中斷多次，每次都由新的解碼器從檢查點繼續，紀錄不會重複或遺漏
+    size_t cut = 0;
+    int resumes = 0;
+    while (reader->status() == IR_BUNDLE_NEED_MORE)
+    {
+        IRBundleCheckpoint state = reader->checkpoint();
+        cut = state.offset + 1 + nextRandom() % (64 * 1024);
+        if (cut > bundle.size())
+            cut = bundle.size();
+        decodeFrom(*reader, bundle, state.offset, cut, v);
+        if (reader->status() != IR_BUNDLE_NEED_MORE)
+            break;
+
+        state = reader->checkpoint();
+        TEST_ASSERT_TRUE(state.offset <= cut);
+        TEST_ASSERT_EQUAL(v.next, state.records);
+        delete reader;
+        reader = new IRBundleReader();
+        TEST_ASSERT_TRUE(reader->resume(state));
+        ++resumes;
+    }
+    TEST_ASSERT_EQUAL(IR_BUNDLE_DONE, reader->status());
+    TEST_ASSERT_TRUE(v.ok);
+    TEST_ASSERT_EQUAL(count, v.next);
+    TEST_ASSERT_TRUE(resumes > 10);
+    delete reader;
+}
+
+static void test_rejects_bad_crc()
+{
+    std::vector<uint8_t> bundle = makeBundle(20);
+    Verify v = freshVerify();
+
+    std::vector<uint8_t> header = bundle;
+    header[8] ^= 0x01; // 標頭的 record_count
+    TEST_ASSERT_EQUAL(IR_BUNDLE_BAD_CRC, decodeAll(header, v));
+
+    std::vector<uint8_t> sample = bundle;
+    sample[bundle.size() / 2] ^= 0x40; // 紀錄內容
+    v = freshVerify();
+    TEST_ASSERT_EQUAL(IR_BUNDLE_BAD_CRC, decodeAll(sample, v));
+
+    std::vector<uint8_t> trailer = bundle;
+    trailer[bundle.size() - 1] ^= 0x01; // 結尾的 body crc
+    v = freshVerify();
+    TEST_ASSERT_EQUAL(IR_BUNDLE_BAD_CRC, decodeAll(trailer, v));
+    TEST_ASSERT_EQUAL(20, v.next);
+}
+
+// 以 header_count 筆的標頭接上 body_count 筆的紀錄與結尾
+static std::vector<uint8_t> spliceBundle(uint32_t header_count, uint32_t body_count)
+{
+    std::vector<uint8_t> header = makeBundle(header_count);
+    std::vector<uint8_t> body = makeBundle(body_count);
+    memcpy(body.data(), header.data(), IR_BUNDLE_HEADER_SIZE);
+    return body;
+}
+
+static void test_rejects_bad_count()
+{
+    std::vector<uint8_t> bundle = makeBundle(20);
+    bundle[bundle.size() - 8] = 21; // 結尾的 record_count
+    Verify v = freshVerify();
+    TEST_ASSERT_EQUAL(IR_BUNDLE_BAD_COUNT, decodeAll(bundle, v));
+
+    // 標頭宣告的數量多於實際紀錄：結尾被當成紀錄解析
+    v = freshVerify();
+    TEST_ASSERT_EQUAL(IR_BUNDLE_BAD_RECORD, decodeAll(spliceBundle(21, 20), v));
+
+    // 標頭宣告的數量少於實際紀錄：多出的紀錄被當成結尾解析
+    v = freshVerify();
+    TEST_ASSERT_EQUAL(IR_BUNDLE_BAD_MAGIC, decodeAll(spliceBundle(19, 20), v));
+    TEST_ASSERT_EQUAL(19, v.next);
+}
+
+static void test_rejects_trailing_data()
+{
+    std::vector<uint8_t> bundle = makeBundle(5);
+    bundle.push_back(0);
+    Verify v = freshVerify();
+    TEST_ASSERT_EQUAL(IR_BUNDLE_TRAILING_DATA, decodeAll(bundle, v));
+
+    // 多餘資料在下一次 feed 才出現也要拒絕
+    bundle.pop_back();
+    IRBundleReader *reader = new IRBundleReader();
+    reader->begin();
+    v = freshVerify();
+    TEST_ASSERT_EQUAL(IR_BUNDLE_DONE, reader->feed(bundle.data(), bundle.size(), verifyRecord, &v));
+    const uint8_t extra = 0;
+    TEST_ASSERT_EQUAL(IR_BUNDLE_TRAILING_DATA, reader->feed(&extra, 1, verifyRecord, &v));
+    delete reader;
+}
+
+static void test_rejects_bad_magic_and_callback()
+{
+    std::vector<uint8_t> bundle = makeBundle(5);
+    Verify v = freshVerify();
+    std::vector<uint8_t> magic = bundle;
+    magic[0] = 'X';
+    TEST_ASSERT_EQUAL(IR_BUNDLE_BAD_MAGIC, decodeAll(magic, v));
+
+    v = freshVerify();
+    v.reject_at = 3; // 例如寫入儲存裝置失敗
+    TEST_ASSERT_EQUAL(IR_BUNDLE_REJECTED, decodeAll(bundle, v));
+    TEST_ASSERT_EQUAL(3, v.next);
+}
+
+static void test_writer_rejects_invalid_records()
+{
+    IRBundleWriter *writer = new IRBundleWriter();
+    writer->begin(1);
+    uint8_t buf[64];
+    while (writer->read(buf, sizeof(buf)) > 0)
+    {
+    }
+    TEST_ASSERT_NULL(writer->beginRecord("", 1));
+    TEST_ASSERT_NULL(writer->beginRecord("bad/name", 1));
+    TEST_ASSERT_NULL(writer->beginRecord("abcdefghijklmnopqrstuvwxyz0123456", 1)); // 33 字元
+    TEST_ASSERT_NULL(writer->beginRecord("tv", IR_BUNDLE_MAX_SAMPLES + 1));
+    TEST_ASSERT_NOT_NULL(writer->beginRecord("tv", IR_BUNDLE_MAX_SAMPLES));
+    delete writer;
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_1mb_random_fragments);
+    RUN_TEST(test_resume_from_checkpoint);
+    RUN_TEST(test_rejects_bad_crc);
+    RUN_TEST(test_rejects_bad_count);
+    RUN_TEST(test_rejects_trailing_data);
+    RUN_TEST(test_rejects_bad_magic_and_callback);
+    RUN_TEST(test_writer_rejects_invalid_records);
+    return UNITY_END();
+}
@@ -0,0 +1,227 @@
+// QoS 1 管線發送吞吐量測試，需要可連線的 MQTT Broker：
+//
+//   mosquitto -c nodelay.conf &     # listener 1883 + set_tcp_nodelay true
+//   PULMOTE_MQTT_BROKER=127.0.0.1 PULMOTE_MQTT_DELAY_MS=20 pio test -e native -f test_mqtt_broker -v
+//
+// 找不到 Broker 時此測試會被略過。本機迴路 RTT 趨近 0，視窗差異不明顯；
+// PULMOTE_MQTT_DELAY_MS 讓每個 PUBLISH 延後送出以模擬網路延遲（也可改用 `tc qdisc ... netem delay`）。
+// Broker 若未關閉 Nagle，連續的 PUBACK 會等前一段被確認才送出，大視窗反而比視窗 1 慢。
+// 以 POSIX socket 取代 WiFiClient，封包組成與 PUBACK 比對沿用裝置端的 mqtt_inflight。
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <deque>
+#include <chrono>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "mqtt_inflight.h"
+
+#define BENCH_MESSAGES 2000
+#define BENCH_PAYLOAD 64
+
+typedef std::chrono::steady_clock Clock;
+
+void setUp() {}
+void tearDown() {}
+
+static const char *brokerHost()
+{
+    const char *host = getenv("PULMOTE_MQTT_BROKER");
+    return host && *host ? host : "127.0.0.1";
+}
+
+static const char *brokerPort()
+{
+    const char *port = getenv("PULMOTE_MQTT_PORT");
+    return port && *port ? port : "1883";
+}
+
+static int delayMs()
+{
+    const char *delay = getenv("PULMOTE_MQTT_DELAY_MS");
+    return delay && *delay ? atoi(delay) : 0;
+}
+
+static int openSocket()
+{
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *result = nullptr;
+    if (getaddrinfo(brokerHost(), brokerPort(), &hints, &result) != 0)
+        return -1;
+    int fd = -1;
+    for (addrinfo *ai = result; ai && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(result);
+    if (fd >= 0)
+    {
+        timeval timeout = {5, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        int one = 1; // 與裝置端相同，關閉 Nagle，連續的 PUBLISH 不等前一段被確認
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+static bool sendAll(int fd, const std::string &data)
+{
+    size_t done = 0;
+    while (done < data.size())
+    {
+        ssize_t n = send(fd, data.data() + done, data.size() - done, 0);
+        if (n <= 0)
+            return false;
+        done += (size_t)n;
+    }
+    return true;
+}
+
+static bool mqttConnect(int fd, const char *client_id)
+{
+    size_t id_len = strlen(client_id);
+    std::string packet;
+    packet.push_back((char)0x10);
+    packet.push_back((char)(10 + 2 + id_len)); // client id 很短，單一位元組即可
+    packet.append("\x00\x04MQTT\x04\x02\x00\x3C", 10); // MQTT 3.1.1，clean session，keep alive 60 s
+    packet.push_back((char)(id_len >> 8));
+    packet.push_back((char)(id_len & 0xFF));
+    packet.append(client_id);
+    if (!sendAll(fd, packet))
+        return false;
+    uint8_t connack[4];
+    size_t got = 0;
+    while (got < sizeof(connack))
+    {
+        ssize_t n = recv(fd, connack + got, sizeof(connack) - got, 0);
+        if (n <= 0)
+            return false;
+        got += (size_t)n;
+    }
+    return connack[0] == 0x20 && connack[3] == 0x00;
+}
+
+struct DelayedPacket
+{
+    Clock::time_point due;
+    std::string data;
+};
+
+// 以指定視窗送出 BENCH_MESSAGES 筆 QoS 1 訊息，回傳每秒確認的訊息數，失敗回傳 0
+static double runWindow(uint8_t size)
+{
+    int fd = openSocket();
+    if (fd < 0)
+        return 0;
+    if (!mqttConnect(fd, "pulmote-bench"))
+    {
+        close(fd);
+        return 0;
+    }
+
+    MQTTInflightWindow window;
+    MQTTPubackScanner scanner;
+    window.setWindow(size);
+    std::string payload(BENCH_PAYLOAD, 'x');
+    std::string packet;
+    std::string batch;
+    std::deque<DelayedPacket> outbox; // 模擬延遲中、尚未寫入 socket 的封包
+    Clock::duration delay = std::chrono::milliseconds(delayMs());
+    uint8_t rx[512];
+    size_t queued = 0;
+    size_t acked = 0;
+    bool ok = true;
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point lastAck = start;
+    while (ok && acked < BENCH_MESSAGES)
+    {
+        while (queued < BENCH_MESSAGES && window.enqueue("pulmote/bench", payload.c_str(), false))
+            ++queued;
+        MQTTOutboundMessage *msg;
+        while ((msg = window.nextToSend()) != nullptr)
+        {
+            mqttEncodePublish(*msg, packet);
+            DelayedPacket delayed = {Clock::now() + delay, packet};
+            outbox.push_back(delayed);
+        }
+        // 已到期的封包合併為一次寫入
+        Clock::time_point now = Clock::now();
+        batch.clear();
+        while (!outbox.empty() && outbox.front().due <= now)
+        {
+            batch += outbox.front().data;
+            outbox.pop_front();
+        }
+        if (!batch.empty() && !sendAll(fd, batch))
+            break;
+
+        int wait_ms = 100;
+        if (!outbox.empty())
+            wait_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(outbox.front().due - now).count();
+        pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, wait_ms < 0 ? 0 : wait_ms) <= 0)
+        {
+            ok = Clock::now() - lastAck < std::chrono::seconds(5); // Broker 不再回應
+            continue;
+        }
+        ssize_t n = recv(fd, rx, sizeof(rx), 0);
+        if (n <= 0)
+            ok = false;
+        for (ssize_t i = 0; i < n; ++i)
+        {
+            uint16_t id;
+            if (scanner.feed(rx[i], id) && window.acknowledge(id))
+            {
+                ++acked;
+                lastAck = Clock::now();
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    sendAll(fd, std::string("\xE0\x00", 2)); // DISCONNECT
+    close(fd);
+    return ok ? acked / seconds : 0;
+}
+
+static void test_pipelined_throughput()
+{
+    int probe = openSocket();
+    if (probe < 0)
+        TEST_IGNORE_MESSAGE("no MQTT broker, set PULMOTE_MQTT_BROKER / PULMOTE_MQTT_PORT");
+    close(probe);
+
+    const uint8_t windows[] = {1, 8, 32};
+    double baseline = 0;
+    for (size_t i = 0; i < sizeof(windows); ++i)
+    {
+        double rate = runWindow(windows[i]);
+        TEST_ASSERT_TRUE_MESSAGE(rate > 0, "broker connection failed during benchmark");
+        if (i == 0)
+            baseline = rate;
+        printf("MQTT QoS 1: window=%-2u %d msgs x %d B  delay %d ms  %.0f msgs/s  (%.2fx window 1)\n",
+               (unsigned)windows[i], BENCH_MESSAGES, BENCH_PAYLOAD, delayMs(), rate, rate / baseline);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pipelined_throughput);
+    return UNITY_END();
+}
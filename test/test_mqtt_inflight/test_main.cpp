@@ -0,0 +1,246 @@
+// MQTT QoS 1 發送視窗單元測試：pio test -e native -f test_mqtt_inflight
+#include <unity.h>
+#include <string>
+#include "mqtt_inflight.h"
+
+void setUp() {}
+void tearDown() {}
+
+// 依序送出視窗允許的所有訊息，回傳送出的數量
+static size_t sendAll(MQTTInflightWindow &window, uint16_t *ids, size_t max)
+{
+    size_t sent = 0;
+    MQTTOutboundMessage *msg;
+    while (sent < max && (msg = window.nextToSend()) != nullptr)
+        ids[sent++] = msg->packet_id;
+    return sent;
+}
+
+static bool scan(MQTTPubackScanner &scanner, const uint8_t *data, size_t len, uint16_t &id)
+{
+    bool found = false;
+    for (size_t i = 0; i < len; ++i)
+        found = scanner.feed(data[i], id) || found;
+    return found;
+}
+
+static void test_window_limits_inflight()
+{
+    MQTTInflightWindow window;
+    window.setWindow(2);
+    for (int i = 0; i < 3; ++i)
+        TEST_ASSERT_TRUE(window.enqueue("t", "p", false));
+    uint16_t ids[4];
+    TEST_ASSERT_EQUAL(2, sendAll(window, ids, 4));
+    TEST_ASSERT_EQUAL(2, window.inflight());
+    TEST_ASSERT_TRUE(window.acknowledge(ids[0]));
+    TEST_ASSERT_EQUAL(1, sendAll(window, ids, 4)); // 收到 PUBACK 後才送出第三筆
+    TEST_ASSERT_EQUAL(2, window.inflight());
+}
+
+static void test_out_of_order_puback()
+{
+    MQTTInflightWindow window;
+    for (int i = 0; i < 3; ++i)
+        window.enqueue("t", "p", false);
+    uint16_t ids[3];
+    TEST_ASSERT_EQUAL(3, sendAll(window, ids, 3));
+
+    TEST_ASSERT_TRUE(window.acknowledge(ids[2]));
+    TEST_ASSERT_TRUE(window.acknowledge(ids[1]));
+    TEST_ASSERT_EQUAL(1, window.inflight());
+    TEST_ASSERT_EQUAL(3, window.pending()); // 前端仍未確認，已確認的訊息暫不移除
+
+    TEST_ASSERT_FALSE(window.acknowledge(ids[1])); // 重複的 PUBACK
+    TEST_ASSERT_FALSE(window.acknowledge(0));
+    TEST_ASSERT_FALSE(window.acknowledge(999));
+
+    TEST_ASSERT_TRUE(window.acknowledge(ids[0]));
+    TEST_ASSERT_EQUAL(0, window.inflight());
+    TEST_ASSERT_EQUAL(0, window.pending());
+}
+
+static void test_dup_resend_after_requeue()
+{
+    MQTTInflightWindow window;
+    window.setWindow(2);
+    window.enqueue("a", "1", false);
+    window.enqueue("b", "2", true);
+    window.enqueue("c", "3", false);
+    uint16_t ids[2];
+    TEST_ASSERT_EQUAL(2, sendAll(window, ids, 2));
+    TEST_ASSERT_TRUE(window.acknowledge(ids[1]));
+
+    window.requeueInflight(); // 模擬斷線重連
+    MQTTOutboundMessage *msg = window.nextToSend();
+    TEST_ASSERT_NOT_NULL(msg);
+    TEST_ASSERT_EQUAL_STRING("a", msg->topic.c_str());
+    TEST_ASSERT_EQUAL(ids[0], msg->packet_id); // 重送沿用原本的 Packet ID
+    TEST_ASSERT_TRUE(msg->dup);
+
+    // 已確認的 b 不會重送，接著送出尚未送過的 c，不帶 DUP
+    msg = window.nextToSend();
+    TEST_ASSERT_NOT_NULL(msg);
+    TEST_ASSERT_EQUAL_STRING("c", msg->topic.c_str());
+    TEST_ASSERT_FALSE(msg->dup);
+    TEST_ASSERT_NULL(window.nextToSend());
+
+    // 重送中的訊息仍可被確認
+    window.requeueInflight();
+    TEST_ASSERT_TRUE(window.acknowledge(ids[0]));
+    msg = window.nextToSend();
+    TEST_ASSERT_NOT_NULL(msg);
+    TEST_ASSERT_EQUAL_STRING("c", msg->topic.c_str());
+    TEST_ASSERT_TRUE(msg->dup);
+}
+
+static void test_packet_id_wraps_to_one()
+{
+    MQTTInflightWindow window;
+    uint16_t last = 0;
+    for (uint32_t i = 0; i < 65536; ++i)
+    {
+        window.enqueue("t", "", false);
+        MQTTOutboundMessage *msg = window.nextToSend();
+        TEST_ASSERT_NOT_NULL(msg);
+        TEST_ASSERT_TRUE(msg->packet_id != 0);
+        last = msg->packet_id;
+        TEST_ASSERT_TRUE(window.acknowledge(last));
+    }
+    TEST_ASSERT_EQUAL(1, last); // 65535 之後回到 1，不使用 0
+}
+
+static void test_packet_id_skips_ids_in_use()
+{
+    MQTTInflightWindow window;
+    window.enqueue("held", "", false);
+    window.enqueue("b", "", false);
+    window.enqueue("c", "", false);
+    MQTTOutboundMessage *held = window.nextToSend();
+    TEST_ASSERT_EQUAL(1, held->packet_id);
+
+    window.setNextPacketId(65535);
+    TEST_ASSERT_EQUAL(65535, window.nextToSend()->packet_id);
+    TEST_ASSERT_EQUAL(2, window.nextToSend()->packet_id); // 1 仍未確認，跳過
+
+    // 已確認但還在暫存區的 ID 也不能重複使用
+    MQTTInflightWindow acked;
+    acked.enqueue("a", "", false);
+    acked.enqueue("b", "", false);
+    acked.enqueue("c", "", false);
+    uint16_t ids[2];
+    sendAll(acked, ids, 2);
+    acked.acknowledge(ids[1]);
+    acked.setNextPacketId(ids[1]);
+    TEST_ASSERT_EQUAL(ids[1] + 1, acked.nextToSend()->packet_id);
+}
+
+static void test_full_store_rejects()
+{
+    MQTTInflightWindow window;
+    for (int i = 0; i < MQTT_RETRY_STORE_SIZE; ++i)
+        TEST_ASSERT_TRUE(window.enqueue("t", "p", false));
+    TEST_ASSERT_FALSE(window.enqueue("t", "overflow", false));
+    TEST_ASSERT_EQUAL(MQTT_RETRY_STORE_SIZE, window.pending());
+
+    MQTTOutboundMessage *msg = window.nextToSend();
+    TEST_ASSERT_TRUE(window.acknowledge(msg->packet_id));
+    TEST_ASSERT_TRUE(window.enqueue("t", "again", false)); // 前端釋放後有空位
+    TEST_ASSERT_FALSE(window.enqueue("t", "overflow", false));
+}
+
+static void test_encode_publish()
+{
+    MQTTOutboundMessage msg;
+    msg.topic = "pulmote/state";
+    msg.payload.assign(200, 'x');
+    msg.packet_id = 0x1234;
+    msg.retain = true;
+    msg.dup = true;
+    std::string out;
+    mqttEncodePublish(msg, out);
+
+    uint32_t remaining = 2 + 13 + 2 + 200; // 217，需兩個位元組編碼
+    TEST_ASSERT_EQUAL(1 + 2 + remaining, out.size());
+    TEST_ASSERT_EQUAL(0x3B, (uint8_t)out[0]); // PUBLISH | DUP | QoS 1 | RETAIN
+    TEST_ASSERT_EQUAL(0x80 | (remaining % 128), (uint8_t)out[1]);
+    TEST_ASSERT_EQUAL(remaining / 128, (uint8_t)out[2]);
+    TEST_ASSERT_EQUAL(13, (uint8_t)out[4]);
+    TEST_ASSERT_EQUAL(0x12, (uint8_t)out[5 + 13]);
+    TEST_ASSERT_EQUAL(0x34, (uint8_t)out[6 + 13]);
+}
+
+static void test_scanner_puback()
+{
+    MQTTPubackScanner scanner;
+    const uint8_t puback[] = {0x40, 0x02, 0xBE, 0xEF};
+    uint16_t id = 0;
+    TEST_ASSERT_TRUE(scan(scanner, puback, sizeof(puback), id));
+    TEST_ASSERT_EQUAL(0xBEEF, id);
+
+    // CONNACK 與 PINGRESP（Remaining Length 為 0）不會被誤認
+    const uint8_t others[] = {0x20, 0x02, 0x00, 0x00, 0xD0, 0x00};
+    TEST_ASSERT_FALSE(scan(scanner, others, sizeof(others), id));
+    TEST_ASSERT_TRUE(scan(scanner, puback, sizeof(puback), id));
+}
+
+static void test_scanner_multibyte_remaining_length()
+{
+    // 收到的 PUBLISH 長度 16384（三個位元組編碼），內容刻意放入像 PUBACK 的位元組
+    std::string stream;
+    stream.push_back((char)0x30);
+    stream.push_back((char)0x80);
+    stream.push_back((char)0x80);
+    stream.push_back((char)0x01);
+    for (int i = 0; i < 16384 / 4; ++i)
+    {
+        stream.push_back((char)0x40);
+        stream.push_back((char)0x02);
+        stream.push_back((char)0x00);
+        stream.push_back((char)0x07);
+    }
+    const uint8_t tail[] = {0x40, 0x02, 0x01, 0x02};
+    stream.append(reinterpret_cast<const char *>(tail), sizeof(tail));
+
+    MQTTPubackScanner scanner;
+    uint16_t id = 0;
+    size_t found = 0;
+    for (size_t i = 0; i < stream.size(); ++i)
+    {
+        if (scanner.feed((uint8_t)stream[i], id))
+            ++found;
+    }
+    TEST_ASSERT_EQUAL(1, found);
+    TEST_ASSERT_EQUAL(0x0102, id);
+
+    // 兩個位元組編碼（長度 200）
+    std::string two;
+    two.push_back((char)0x30);
+    two.push_back((char)0xC8);
+    two.push_back((char)0x01);
+    two.append(200, (char)0x40);
+    two.append(reinterpret_cast<const char *>(tail), sizeof(tail));
+    scanner.reset();
+    found = 0;
+    for (size_t i = 0; i < two.size(); ++i)
+    {
+        if (scanner.feed((uint8_t)two[i], id))
+            ++found;
+    }
+    TEST_ASSERT_EQUAL(1, found);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_window_limits_inflight);
+    RUN_TEST(test_out_of_order_puback);
+    RUN_TEST(test_dup_resend_after_requeue);
+    RUN_TEST(test_packet_id_wraps_to_one);
+    RUN_TEST(test_packet_id_skips_ids_in_use);
+    RUN_TEST(test_full_store_rejects);
+    RUN_TEST(test_encode_publish);
+    RUN_TEST(test_scanner_puback);
+    RUN_TEST(test_scanner_multibyte_remaining_length);
+    return UNITY_END();
+}